@@ -0,0 +1,56 @@
+/*
+ * arena.c
+ *
+ * Created: 19/10/2026 4:50:58 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "arena.h"
+#include "sram.h"
+
+// What each phase may borrow, checked as it borrows
+static const uint16_t phase_bytes[] PROGMEM = {
+	ARENA_SPLASH_BYTES, ARENA_GAME_BYTES, ARENA_GAME_OVER_BYTES
+};
+
+ARENA_CHECK(every_phase, sizeof(phase_bytes)/sizeof(phase_bytes[0]) == NUM_PHASES);
+ARENA_CHECK(within_budget, ARENA_SIZE <= ARENA_BUDGET);
+// The display buffer is indexed with an 8 bit variable
+ARENA_CHECK(term_index, TERM_BUFFER_SIZE <= 255);
+
+static uint8_t arena[ARENA_SIZE];
+static uint16_t arena_used;
+static uint16_t arena_max_used;
+static uint8_t current_phase;
+
+SRAM_USAGE(arena, sizeof(arena) + sizeof(arena_used) + sizeof(arena_max_used)
+	+ sizeof(current_phase));
+
+void arena_begin_phase(uint8_t phase) {
+	current_phase = phase;
+	arena_used = 0;
+}
+
+void* arena_alloc(uint16_t bytes) {
+	if (bytes > pgm_read_word(&phase_bytes[current_phase]) - arena_used) {
+		printf_P(PSTR("FAULT: phase %u borrowed more than its arena total!"), current_phase);
+		while (1){}
+	}
+	void* block = &arena[arena_used];
+	arena_used += bytes;
+	if (arena_used > arena_max_used) {
+		arena_max_used = arena_used;
+	}
+	return block;
+}
+
+uint8_t arena_phase(void) {
+	return current_phase;
+}
+
+uint16_t arena_peak(void) {
+	return arena_max_used;
+}
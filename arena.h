@@ -0,0 +1,65 @@
+/*
+ * arena.h
+ *
+ * Created: 19/10/2026 4:51:06 PM
+ *  Author: Kenton
+ *
+ * Shared scratch memory for the big buffers which are only needed in
+ * one phase of the program. The splash screen, the game and the game
+ * over screen never run at the same time, so rather than each module
+ * keeping its own static buffer they borrow from one arena. Starting a
+ * phase releases everything borrowed in the previous phase, so a module
+ * must borrow its buffer again at the start of each phase it runs in
+ * and must not touch it afterwards.
+ *
+ * The arena is sized at compile time from what each phase borrows
+ * (below). If a phase's borrowing changes, update its total - a phase
+ * which borrows more than its total halts with a fault, even if the
+ * arena has room.
+ */
+
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdint.h>
+
+// Phases
+#define PHASE_SPLASH	0
+#define PHASE_GAME		1
+#define PHASE_GAME_OVER	2
+#define NUM_PHASES		3
+
+// Sizes of the buffers borrowed from the arena
+#define TERM_BUFFER_SIZE	255		// display.c - terminal output for a frame
+#define NAME_BUFFER_SIZE	13		// leaderboard.c - name being entered
+
+// What each phase borrows in total
+#define ARENA_SPLASH_BYTES		0
+#define ARENA_GAME_BYTES		(TERM_BUFFER_SIZE)
+#define ARENA_GAME_OVER_BYTES	(NAME_BUFFER_SIZE)
+
+#define ARENA_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define ARENA_SIZE ARENA_MAX(ARENA_SPLASH_BYTES, \
+	ARENA_MAX(ARENA_GAME_BYTES, ARENA_GAME_OVER_BYTES))
+
+// Most SRAM we are prepared to give the arena
+#define ARENA_BUDGET 512
+
+// Compile time check - a negative array size (compile error) if the
+// condition is false, e.g. ARENA_CHECK(name_fits, NAME_LEN+1 <= NAME_BUFFER_SIZE);
+#define ARENA_CHECK(name, condition) \
+	typedef char arena_check_##name[(condition) ? 1 : -1]
+
+// Release everything borrowed so far and start the given phase
+void arena_begin_phase(uint8_t phase);
+
+// Borrow bytes from the arena until the next phase begins. Halts with a
+// fault message if the phase borrows more than its total above.
+void* arena_alloc(uint16_t bytes);
+
+// The current phase and the most bytes borrowed at once since reset
+uint8_t arena_phase(void);
+uint16_t arena_peak(void);
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,301 @@
+/*
+ * console.c
+ *
+ * Created: 20/10/2026 8:31:12 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "console.h"
+#include "settings.h"
+#include "keys.h"
+#include "terminalio.h"
+#include "serialio.h"
+#include "timer0.h"
+#include "sram.h"
+
+#define PROMPT_Y	(Y_STATS+1)
+#define OUTPUT_Y	(Y_STATS+2)
+
+static char line[CONSOLE_LINE_LENGTH+1];
+static uint8_t length;
+static uint8_t active;
+
+// While a new baud rate is waiting to be confirmed - the rate to go
+// back to, when to give up, and when to show the prompt again
+static uint8_t confirming;
+static long old_baud;
+static uint16_t confirm_deadline;
+static uint16_t confirm_reminder;
+
+SRAM_USAGE(console, sizeof(line) + sizeof(length) + sizeof(active)
+	+ sizeof(confirming) + sizeof(old_baud) + sizeof(confirm_deadline)
+	+ sizeof(confirm_reminder));
+
+uint8_t console_active(void) {
+	return active;
+}
+
+// Clear the output rows
+static void clear_output(void) {
+	for (uint8_t y = OUTPUT_Y; y < Y_STATS+CONSOLE_ROWS; y++) {
+		move_cursor(X_STATS, y);
+		clear_to_end_of_line();
+	}
+}
+
+static void draw_prompt(void) {
+	move_cursor(X_STATS, PROMPT_Y);
+	if (confirming) {
+		printf_P(PSTR("Press enter to keep %ld baud (%us)"), serial_baud(),
+			TIME_SINCE(confirm_deadline, get_fast_time()) / 1000 + 1);
+	} else {
+		printf_P(PSTR("%c> %s"), settings_changed() ? '*' : ' ', line);
+	}
+	clear_to_end_of_line();
+}
+
+// Print a message on the first output row
+static void message(const char* format) {
+	clear_output();
+	move_cursor(X_STATS, OUTPUT_Y);
+	printf_P(format);
+}
+
+static void print_setting(uint8_t n, uint8_t y) {
+	move_cursor(X_STATS, y);
+	printf_P(PSTR("%-16S %5u (%u-%u, default %u)"), setting_name(n),
+		SETTING(n), setting_min(n), setting_max(n), setting_default(n));
+	clear_to_end_of_line();
+}
+
+static void draw_console(void) {
+	move_cursor(X_STATS, Y_STATS);
+	set_display_attribute(TERM_REVERSE);
+	printf_P(PSTR("Settings: list get set save load defaults baud exit"));
+	set_display_attribute(TERM_RESET);
+	clear_to_end_of_line();
+	clear_output();
+	draw_prompt();
+	show_cursor();
+}
+
+void console_open(void) {
+	active = 1;
+	confirming = 0;
+	length = 0;
+	line[0] = '\0';
+	draw_console();
+}
+
+static void close_console(void) {
+	active = 0;
+	hide_cursor();
+	for (uint8_t y = Y_STATS; y < Y_STATS+CONSOLE_ROWS; y++) {
+		move_cursor(X_STATS, y);
+		clear_to_end_of_line();
+	}
+}
+
+// Parse a decimal number (up to a million, for baud rates). Returns
+// the character after it, or NULL if there isn't a valid number.
+static char* parse_number(char* s, uint32_t* value) {
+	uint32_t n = 0;
+	char* start = s;
+	while (*s >= '0' && *s <= '9') {
+		n = n*10 + (*s++ - '0');
+		if (n > 1000000) {
+			return NULL;
+		}
+	}
+	if (s == start) {
+		return NULL;
+	}
+	*value = n;
+	return s;
+}
+
+// Split off the next space separated word, returning the rest of the
+// line (or an empty string)
+static char* next_word(char* s) {
+	while (*s && *s != ' ') {
+		s++;
+	}
+	if (*s) {
+		*s++ = '\0';
+		while (*s == ' ') {
+			s++;
+		}
+	}
+	return s;
+}
+
+// Switch to a new baud rate, which has to be confirmed by pressing
+// enter at the new rate before CONSOLE_BAUD_TIMEOUT runs out.
+static void change_baud(uint32_t baud) {
+	uint16_t error = serial_baud_error(baud);
+	if (error > SERIAL_MAX_BAUD_ERROR) {
+		clear_output();
+		move_cursor(X_STATS, OUTPUT_Y);
+		printf_P(PSTR("Can't get within %u.%u%% of that"),
+			SERIAL_MAX_BAUD_ERROR/10, SERIAL_MAX_BAUD_ERROR%10);
+		return;
+	}
+	clear_output();
+	move_cursor(X_STATS, OUTPUT_Y);
+	printf_P(PSTR("Switching to %ld baud (%u.%u%% out)"), (long)baud,
+		error/10, error%10);
+	old_baud = serial_baud();
+	set_serial_baud(baud);
+	confirming = 1;
+	confirm_deadline = get_fast_time() + CONSOLE_BAUD_TIMEOUT;
+	confirm_reminder = get_fast_time();
+}
+
+static void confirm_baud(void) {
+	confirming = 0;
+	// Remember it if it's one the setting can hold, so save keeps it
+	long baud = serial_baud();
+	if (baud % 100 == 0 && baud/100 <= UINT16_MAX) {
+		set_setting(SET_BAUD_X100, baud/100);
+	}
+	draw_console();
+	move_cursor(X_STATS, OUTPUT_Y);
+	printf_P(PSTR("Now at %ld baud"), baud);
+}
+
+void console_poll(void) {
+	if (!confirming) {
+		return;
+	}
+	uint16_t now = get_fast_time();
+	if (TIME_REACHED(now, confirm_deadline)) {
+		set_serial_baud(old_baud);
+		confirming = 0;
+		draw_console();
+		move_cursor(X_STATS, OUTPUT_Y);
+		printf_P(PSTR("No enter seen - back to %ld baud"), old_baud);
+	} else if (TIME_REACHED(now, confirm_reminder)) {
+		// Keep showing the prompt, since the terminal only sees it
+		// once it has been switched over too
+		draw_prompt();
+		confirm_reminder = now + 1000;
+	}
+}
+
+// Run the command line. Returns 1 if it closes the console.
+static uint8_t run_command(void) {
+	char* command = line;
+	while (*command == ' ') {
+		command++;
+	}
+	char* name = next_word(command);
+	char* rest = next_word(name);
+	
+	if (*command == '\0') {
+		return 0;
+	}
+	if (strcmp_P(command, PSTR("exit")) == 0) {
+		return 1;
+	}
+	if (strcmp_P(command, PSTR("list")) == 0) {
+		clear_output();
+		for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+			print_setting(i, OUTPUT_Y+i);
+		}
+		return 0;
+	}
+	if (strcmp_P(command, PSTR("save")) == 0) {
+		save_settings();
+		message(PSTR("Saved"));
+		return 0;
+	}
+	if (strcmp_P(command, PSTR("load")) == 0) {
+		if (load_settings()) {
+			message(PSTR("No saved settings - defaults"));
+		} else {
+			message(PSTR("Loaded"));
+		}
+		return 0;
+	}
+	if (strcmp_P(command, PSTR("baud")) == 0) {
+		uint32_t baud;
+		char* end = parse_number(name, &baud);
+		if (!end || *end != '\0' || baud == 0) {
+			message(PSTR("Expected a baud rate"));
+			return 0;
+		}
+		change_baud(baud);
+		return 0;
+	}
+	if (strcmp_P(command, PSTR("defaults")) == 0) {
+		default_settings();
+		message(PSTR("Defaults (not saved)"));
+		return 0;
+	}
+	
+	uint8_t set = (strcmp_P(command, PSTR("set")) == 0);
+	if (!set && strcmp_P(command, PSTR("get")) != 0) {
+		message(PSTR("Unknown command"));
+		return 0;
+	}
+	int8_t n = find_setting(name);
+	if (n < 0) {
+		message(PSTR("No such setting"));
+		return 0;
+	}
+	if (set) {
+		uint32_t value;
+		char* end = parse_number(rest, &value);
+		if (!end || *end != '\0') {
+			message(PSTR("Expected a number"));
+			return 0;
+		}
+		if (value > UINT16_MAX || set_setting(n, value)) {
+			message(PSTR("Out of range"));
+			return 0;
+		}
+	}
+	clear_output();
+	print_setting(n, OUTPUT_Y);
+	return 0;
+}
+
+uint8_t console_key(int16_t key) {
+	if (confirming) {
+		// Only enter counts - anything else could be noise from the
+		// terminal still being at the old rate
+		if (key == '\n' || key == '\r') {
+			confirm_baud();
+		}
+		return 0;
+	}
+	if (key == KEY_ESCAPE) {
+		close_console();
+		return 1;
+	}
+	if (key == '\n' || key == '\r') {
+		uint8_t closing = run_command();
+		length = 0;
+		line[0] = '\0';
+		if (closing) {
+			close_console();
+			return 1;
+		}
+	} else if (key == 0x7f || key == '\b') {
+		if (length) {
+			line[--length] = '\0';
+		}
+	} else if (key >= ' ' && key < 0x7f && length < CONSOLE_LINE_LENGTH) {
+		line[length++] = key;
+		line[length] = '\0';
+	} else {
+		// Ignore other keys (cursor keys etc.)
+		return 0;
+	}
+	draw_prompt();
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * console.h
+ *
+ * Created: 20/10/2026 8:31:05 PM
+ *  Author: Kenton
+ *
+ * A small command console for tuning the settings (settings.h) over the
+ * serial terminal while the game is running. Escape opens it (pausing
+ * the game) in the statistics area beside the field, and from then on
+ * every key goes to it until it is closed with exit or escape again.
+ *
+ *   list				every setting with its value, range and default
+ *   get <name>			one setting
+ *   set <name> <value>	change a setting (not saved)
+ *   save				write the settings to EEPROM
+ *   load				go back to the settings in EEPROM (or the defaults
+ *						if none are saved)
+ *   defaults			go back to the defaults (not saved)
+ *   baud <rate>		switch the terminal to a new baud rate
+ *   exit				close the console and apply the settings
+ *
+ * After baud, enter has to be pressed at the new rate within
+ * CONSOLE_BAUD_TIMEOUT or the console switches back, so a rate the
+ * terminal can't do doesn't lose the board. A confirmed rate is also
+ * put in the baud_x100 setting, to be kept with save.
+ *
+ * A '*' after the prompt means there are changes which haven't been
+ * saved.
+ */
+
+
+#ifndef CONSOLE_H_
+#define CONSOLE_H_
+
+#include <stdint.h>
+
+// Longest command line
+#define CONSOLE_LINE_LENGTH 32
+
+// Rows used below Y_STATS (the title, prompt and output)
+#define CONSOLE_ROWS 16
+
+// Time to confirm a new baud rate (milliseconds)
+#define CONSOLE_BAUD_TIMEOUT 10000
+
+// Open the console and draw it
+void console_open(void);
+
+// Whether the console is open
+uint8_t console_active(void);
+
+// Give a key (from key_pressed()) to the console. Returns 1 if it
+// closed the console, in which case the caller should apply the
+// settings and carry on with the game.
+uint8_t console_key(int16_t key);
+
+// Called regularly (from the input task) to time out a baud rate
+// change which hasn't been confirmed
+void console_poll(void);
+
+#endif /* CONSOLE_H_ */
@@ -0,0 +1,97 @@
+/*
+ * cpuload.c
+ *
+ * Created: 18/10/2026 5:40:47 PM
+ *  Author: Kenton
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
+
+#include "cpuload.h"
+#include "terminalio.h"
+#include "timer0.h"
+#include "cycles.h"
+#include "scheduler.h"
+
+// Length of the measurement window in cycles (one second)
+#define WINDOW_CYCLES (1000L*TIMER0_COUNTS_PER_MS*TIMER0_CYCLES_PER_COUNT)
+
+// Cycles spent asleep in the current window, and when it started. Times
+// are from the 32 bit cycle counter, which wraps every ~9 minutes, so a
+// loop which doesn't sleep for a long time is still measured properly.
+static uint32_t idle_cycles;
+static uint32_t window_start;
+
+// Figures for the last complete window
+static uint32_t last_idle_cycles;
+static uint32_t last_window_cycles = WINDOW_CYCLES;
+
+// Close the window if it has run its length. Called on every pass, not
+// only after sleeping, so a window still closes when the CPU never
+// sleeps (which is when the figures matter most).
+static void end_window(uint32_t now) {
+	uint32_t length = now - window_start;
+	if (length >= WINDOW_CYCLES) {
+		last_idle_cycles = idle_cycles;
+		last_window_cycles = length;
+		idle_cycles = 0;
+		window_start = now;
+	}
+}
+
+void cpu_idle(void) {
+	uint32_t sleep_start;
+	
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	
+	// An interrupt may have given the main loop work (a bottom half, or
+	// a task falling due) since it last looked. With interrupts off,
+	// check for any before going to sleep - from here until the sleep
+	// no interrupt can be handled, and the instruction after sei() is
+	// always executed before any pending interrupt, so anything that
+	// arrives later wakes us.
+	// Input isn't checked. In the game it is only read by the input
+	// task, which tasks_due() covers. Elsewhere (the splash screen and
+	// name entry poll it every pass) input which arrived just before
+	// this waits for the next interrupt - at most the 1ms tick.
+	cli();
+	if (timer0_bottom_halves_pending() || tasks_due()) {
+		sei();
+		end_window(get_cycles());
+		return;
+	}
+	sleep_start = get_cycles();
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	
+	// We get here once the interrupt which woke us has been handled.
+	// (That handler's time is counted as idle.)
+	uint32_t now = get_cycles();
+	idle_cycles += now - sleep_start;
+	end_window(now);
+}
+
+uint32_t cpu_idle_cycles(void) {
+	return last_idle_cycles;
+}
+
+uint32_t cpu_busy_cycles(void) {
+	return last_window_cycles - last_idle_cycles;
+}
+
+uint8_t cpu_utilisation(void) {
+	return 100 - (uint8_t)(last_idle_cycles * 100 / last_window_cycles);
+}
+
+void print_cpu_load(uint8_t x, uint8_t y) {
+	move_cursor(x, y);
+	printf_P(PSTR("CPU: %3u%% busy (%lu busy, %lu idle cycles/s)"),
+		cpu_utilisation(), cpu_busy_cycles(), cpu_idle_cycles());
+	clear_to_end_of_line();
+}
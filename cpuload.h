@@ -0,0 +1,34 @@
+/*
+ * cpuload.h
+ *
+ * Created: 18/10/2026 5:41:02 PM
+ *  Author: Kenton
+ *
+ * Idle handling for the main loop. When the main loop has nothing left
+ * to do it calls cpu_idle() which puts the CPU into idle sleep until
+ * the next interrupt (at the latest the next timer 0 tick, 1ms away).
+ * Any interrupt wakes it again - all state the main loop waits on is
+ * changed from an interrupt handler. Time spent asleep is counted so we
+ * can report how busy the CPU was over the last second.
+ */
+
+
+#ifndef CPULOAD_H_
+#define CPULOAD_H_
+
+#include <stdint.h>
+
+// Sleep until the next interrupt, accounting for the time spent idle.
+void cpu_idle(void);
+
+// Cycles spent busy and idle over the last complete one second window
+uint32_t cpu_busy_cycles(void);
+uint32_t cpu_idle_cycles(void);
+
+// Percentage of the last second spent busy (0 to 100)
+uint8_t cpu_utilisation(void);
+
+// Print the figures above at the given terminal position
+void print_cpu_load(uint8_t x, uint8_t y);
+
+#endif /* CPULOAD_H_ */
@@ -0,0 +1,50 @@
+/*
+ * cycles.c
+ *
+ * Created: 19/10/2026 9:02:08 AM
+ *  Author: Kenton
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "cycles.h"
+#include "isrstats.h"
+
+volatile uint16_t cycle_overflows;
+
+void init_cycle_counter(void) {
+	cycle_overflows = 0;
+	TCNT2 = 0;
+	
+	// Normal mode, clock divided by 8
+	TCCR2A = 0;
+	TCCR2B = (1<<CS21);
+	
+	// Clear any pending overflow (by writing a 1) and enable the
+	// overflow interrupt
+	TIFR2 = (1<<TOV2);
+	TIMSK2 |= (1<<TOIE2);
+}
+
+uint32_t get_cycles(void) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	uint8_t count = TCNT2;
+	uint16_t high = cycle_overflows;
+	// If the timer has overflowed but the interrupt hasn't been handled
+	// yet (because interrupts are off) the overflow count is one behind.
+	if((TIFR2 & (1<<TOV2)) && count < 128) {
+		high++;
+	}
+	if(interruptsOn) {
+		sei();
+	}
+	return ((((uint32_t)high) << 8) | count) * CYCLES_PER_COUNT;
+}
+
+ISR(TIMER2_OVF_vect) {
+	ISR_STATS_ENTER();
+	cycle_overflows++;
+	ISR_STATS_EXIT(ISR_TIMER2_OVF);
+}
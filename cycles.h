@@ -0,0 +1,32 @@
+/*
+ * cycles.h
+ *
+ * Created: 19/10/2026 9:02:15 AM
+ *  Author: Kenton
+ *
+ * Free running cycle counter for timing code. Timer 2 runs at the
+ * clock divided by 8 and an overflow interrupt (every 2048 cycles)
+ * extends it to 32 bits, so it wraps every ~9 minutes and has a
+ * resolution of 8 cycles. (Timer 1 isn't free - it drives the buzzer.)
+ */
+
+
+#ifndef CYCLES_H_
+#define CYCLES_H_
+
+#include <stdint.h>
+
+#define CYCLES_PER_COUNT 8
+
+// Number of times timer 2 has overflowed - the upper bits of the count.
+// On its own it's a cheap 256 microsecond tick (see trace.h).
+extern volatile uint16_t cycle_overflows;
+
+// Set up timer 2. Interrupts must be enabled globally afterwards.
+void init_cycle_counter(void);
+
+// Return the number of clock cycles since init_cycle_counter() (to
+// the nearest 8). Safe to call with interrupts on or off.
+uint32_t get_cycles(void);
+
+#endif /* CYCLES_H_ */
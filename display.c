@@ -15,7 +15,14 @@
 #include "ledmatrix.h"
 #include "pixel_colour.h"
 #include "timer0.h"
-#include "spi.h"
+#include "profile.h"
+#include "iostats.h"
+#include "sram.h"
+#include "arena.h"
+#include "emit.h"
+#include "latency.h"
+#include "trace.h"
+#include "telemetry.h"
 
 #define LED_MATRIX_POSN_FROM_XY(gameX, gameY)		(gameY) , (7-(gameX))
 #define TERM_POS_FROM_GAME_POS(pos) (GET_X_POSITION(pos)*2+X_LEFT+1), (Y_BOTTOM-1-GET_Y_POSITION(pos))
@@ -25,31 +32,36 @@
 
 static void draw_pixel(uint8_t x, uint8_t y, uint8_t colour);
 
-uint32_t curState[16];
-uint32_t newState[16];
-
-char termBuffer[255];
+// Terminal output for the current frame (borrowed from the arena for
+// the game phase by init_display_buffer())
+char* termBuffer;
 uint8_t termIndex;
 
-char terminalBuffer[255];
-
 uint8_t readingIntoFrame = 0;
 
 uint8_t prev_draw_x;
 
-/*uint8_t stateBitMask;*/
+#if LATENCY_PIN
+uint8_t latency_armed;
+#endif
 
-void reset_frame() {
-	memset(curState, 0, sizeof(curState));	
-	memset(newState, 0, sizeof(newState));	
+SRAM_USAGE(display, sizeof(termBuffer) + sizeof(termIndex)
+	+ sizeof(readingIntoFrame) + sizeof(prev_draw_x));
+
+void init_display_buffer() {
+	termBuffer = arena_alloc(TERM_BUFFER_SIZE);
+	termIndex = 0;
 }
 
+/*uint8_t stateBitMask;*/
+
 void new_frame() {
 // 	if (readingIntoFrame) {
 // 		printf_P(PSTR("FAULT: new_frame called while reading new frame!"));
 // 		while (1){}
 // 	}
 	readingIntoFrame = 1;
+	TRACE(TRACE_FRAME_START, 0, 0);
 	/*stateBitMask = (~bitsToClear) & 0xf;*/
 
 }
@@ -60,46 +72,18 @@ void set_pixel(uint8_t x, uint8_t y, uint8_t colour) {
 		while (1){}
 	}
 	draw_pixel(x, y, colour);
-	return;
-	uint32_t val;
-	switch (colour) {
-		case COLOUR_BLACK:
-		val = CODE_BLACK;
-		break;
-		case COLOUR_GREEN:
-		val = CODE_GREEN;
-		break;
-		case COLOUR_RED:
-		val = CODE_RED;
-		break;
-		case COLOUR_YELLOW:
-		val = CODE_YELLOW;
-		break;
-		default:
-		val = 0;
-		break;
-	}
-	
-	newState[y] |= (val) << (4*x);	
-}
-
-// https://stackoverflow.com/a/53175/2734389
-uint8_t hob (uint8_t num)
-{
-	if (!num)
-		return 0;
-	uint8_t ret = 1;
-	while (num >>= 1)
-		ret <<= 1;
-	return ret;
 }
 
 void print_terminal_buffer() {
-	if (! (PIND & (1<<PIND3))) {
-		printf("%s", termBuffer);
+	if (termIndex == 0) {
+		return; // nothing buffered
+	}
+	PROFILE_START(PROF_PRINT_TERMINAL);
+	if (!SWITCH_D3()) {
+		emit_buffer(termBuffer, termIndex);
 	}
 	termIndex = 0;
-	memset(termBuffer, 0, sizeof(termBuffer));
+	PROFILE_END(PROF_PRINT_TERMINAL);
 }
 
 void draw_pixel(uint8_t x, uint8_t y, uint8_t colour) {
@@ -112,21 +96,21 @@ void draw_pixel(uint8_t x, uint8_t y, uint8_t colour) {
 	/*sprintf_P(termBuffer+termIndex, PSTR("\x1b[%d;%dH"), term_y, term_x);*/
 	termIndex += s_move_cursor(termBuffer+termIndex, term_x, term_y);
 	if (colour == COLOUR_BLACK) {
-		termIndex += sprintf_P(termBuffer+termIndex, PSTR(" "));
+		termBuffer[termIndex++] = ' ';
 	} else {
 		switch (colour) {
 			case COLOUR_GREEN:
 			termIndex += s_fast_set_display_attr(termBuffer+termIndex, FG_GREEN);
-			termIndex += sprintf_P(termBuffer+termIndex, PSTR("@"));
+			termBuffer[termIndex++] = '@';
 			break;
 			case COLOUR_RED:
 			termIndex += s_fast_set_display_attr(termBuffer+termIndex, FG_RED);
-			termIndex += sprintf_P(termBuffer+termIndex, PSTR("|"));
+			termBuffer[termIndex++] = '|';
 			break;
 			case COLOUR_YELLOW:
 			default:
 			termIndex += s_fast_set_display_attr(termBuffer+termIndex, FG_YELLOW);
-			termIndex += sprintf_P(termBuffer+termIndex, PSTR("#"));
+			termBuffer[termIndex++] = '#';
 			break;
 		}
 		
@@ -134,65 +118,17 @@ void draw_pixel(uint8_t x, uint8_t y, uint8_t colour) {
 // 		printf("%s", c);
 	} 
 	ledmatrix_update_pixel(LED_MATRIX_POSN_FROM_XY(x, y), colour);
+	if (colour != COLOUR_BLACK) {
+		LATENCY_SHOWN();
+	}
 }
 
 void draw_frame() {
-	flush_spi_buffer();
-	print_terminal_buffer();
-	return;
-	uint32_t startTime = get_current_time();
-	if (!readingIntoFrame) {
-		printf_P(PSTR("FAULT: draw_frame called without frame!"));
-		while (1){}
-	}
-	
-	start_spi_buffer();
-	s_invalidate_mode();
-	readingIntoFrame = 1;
-	for (uint8_t y = 0; y < 16; y++) {
-		/*printf("y=%d, %x\n", y, curState[y]);*/
-		for (uint8_t x = 0; x < 8; x++) {
-			
-			uint32_t cur_bits = (curState[y]>>(4*x)) & 0xf;
-			/*printf("  x=%d, %x\n", x, cur_bits);*/
-			uint32_t new_bits = ((newState[y]>>(4*x))&0xf);
-			if (new_bits == 0) {
-				/*printf("Null %d,%d", x, y);*/
-				 continue; // no colour requests received.
-			}
-			uint8_t new_code = hob(new_bits);
-			
-			if (new_code == hob(cur_bits)) {
-				/*printf("Same %d,%d", x, y);*/
-				continue; // same colour already displayed.
-			}
-			/*printf("Drawing %d,%d", x, y);*/
-			curState[y] = (curState[y] & ~(0xf<<(4*x))) | (new_code << (4*x) );
-			uint8_t val;
-			switch (new_code) {
-				case CODE_BLACK:
-				val = COLOUR_BLACK;
-				break;
-				case CODE_GREEN:
-				val = COLOUR_GREEN;
-				break;
-				case CODE_RED:
-				val = COLOUR_RED;
-				break;
-				case CODE_YELLOW:
-				val = COLOUR_YELLOW;
-				break;
-				default:
-				val = 0;
-				break;
-			}
-			draw_pixel(x, y, val);
-		}
-	}
+	// The LED matrix is updated as each pixel is drawn, so only the
+	// terminal output is left to send
+	PROFILE_START(PROF_DRAW_FRAME);
 	print_terminal_buffer();
-	flush_spi_buffer();
-	memset(newState, 0, sizeof(newState));
-	move_cursor(0, 0);
-	set_display_attribute(TERM_RESET);
-	printf("%3lu", get_current_time()-startTime);
+	io_stats_end_frame();
+	TRACE(TRACE_FRAME_END, 0, 0);
+	PROFILE_END(PROF_DRAW_FRAME);
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+/*
+ * eequeue.c
+ *
+ * Created: 21/10/2026 10:14:44 AM
+ *  Author: Kenton
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "eequeue.h"
+#include "isrstats.h"
+#include "sram.h"
+
+typedef struct {
+	const uint8_t* src;		// next byte to write
+	uint16_t address;		// where it goes
+	uint8_t length;			// bytes left
+} EepromWrite;
+
+// Circular queue in the same style as the serial buffers - the oldest
+// write is writes_queued before the insert position
+static EepromWrite writes[EEPROM_QUEUE_SIZE];
+static uint8_t write_insert_pos;
+static volatile uint8_t writes_queued;
+
+SRAM_USAGE(eequeue, sizeof(writes) + sizeof(write_insert_pos)
+	+ sizeof(writes_queued));
+
+static EepromWrite* oldest_write(void) {
+	int8_t pos = write_insert_pos - writes_queued;
+	if (pos < 0) {
+		pos += EEPROM_QUEUE_SIZE;
+	}
+	return &writes[pos];
+}
+
+// Start writing the next byte which differs from what's in the EEPROM,
+// skipping any which are already right. Returns 0 if there was nothing
+// left to write. Must be called with interrupts off and no write in
+// progress.
+static uint8_t start_next_byte(void) {
+	while (writes_queued) {
+		EepromWrite* w = oldest_write();
+		if (w->length == 0) {
+			writes_queued--;
+			continue;
+		}
+		uint8_t value = *w->src++;
+		EEAR = w->address++;
+		w->length--;
+		EECR |= (1<<EERE);
+		if (EEDR != value) {
+			// Erase and write in one operation. EEPE has to be set
+			// within four cycles of EEMPE.
+			EEDR = value;
+			EECR = (1<<EERIE)|(1<<EEMPE);
+			EECR |= (1<<EEPE);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Carry on with the queue without the interrupt (interrupts are off)
+static void write_by_polling(void) {
+	do {
+		while (EECR & (1<<EEPE)) {
+			/* wait for the last byte */
+		}
+	} while (start_next_byte());
+	EECR &= ~(1<<EERIE);
+}
+
+void queue_eeprom_write(uint16_t address, const void* src, uint8_t length) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	if (writes_queued >= EEPROM_QUEUE_SIZE) {
+		if (interrupts_enabled) {
+			while (writes_queued >= EEPROM_QUEUE_SIZE) {
+				/* the interrupt handler will make room */
+			}
+		} else {
+			write_by_polling();
+		}
+	}
+	
+	cli();
+	EepromWrite* w = &writes[write_insert_pos++];
+	w->src = src;
+	w->address = address;
+	w->length = length;
+	writes_queued++;
+	if (write_insert_pos == EEPROM_QUEUE_SIZE) {
+		write_insert_pos = 0;
+	}
+	// The interrupt fires whenever the EEPROM is ready, so this starts
+	// the write straight away if nothing else is being written
+	EECR |= (1<<EERIE);
+	if (interrupts_enabled) {
+		sei();
+	}
+}
+
+uint8_t eeprom_writes_pending(void) {
+	return writes_queued || (EECR & (1<<EEPE));
+}
+
+void flush_eeprom_writes(void) {
+	if (!bit_is_set(SREG, SREG_I)) {
+		write_by_polling();
+	}
+	while (eeprom_writes_pending()) {
+		/* the interrupt handler is working through the queue */
+	}
+}
+
+ISR(EE_READY_vect) {
+	ISR_STATS_ENTER();
+	if (!start_next_byte()) {
+		// Nothing left - stop the interrupt firing
+		EECR &= ~(1<<EERIE);
+	}
+	ISR_STATS_EXIT(ISR_EE_READY);
+}
@@ -0,0 +1,44 @@
+/*
+ * eequeue.h
+ *
+ * Created: 21/10/2026 10:14:37 AM
+ *  Author: Kenton
+ *
+ * Background EEPROM writes. Each EEPROM byte takes about 3.4ms to
+ * write, so rather than waiting for each one, writes are queued and
+ * carried out from the EEPROM ready interrupt while the game carries
+ * on. Only bytes which differ from what's already in the EEPROM are
+ * written, which also saves wear.
+ *
+ * A queued write copies from the source in RAM as it goes, so the
+ * source has to stay valid until the write finishes - and if it
+ * changes in the meantime, the newer contents are what get written.
+ *
+ * Nothing else may read or write the EEPROM while writes are pending
+ * (the interrupt handler owns the EEPROM address register), so call
+ * flush_eeprom_writes() first. It's also the barrier to use before
+ * anything which could lose power or reset the board.
+ */
+
+
+#ifndef EEQUEUE_H_
+#define EEQUEUE_H_
+
+#include <stdint.h>
+
+// Writes which can be waiting at once
+#define EEPROM_QUEUE_SIZE 8
+
+// Queue a write of length bytes from src to EEPROM address. Waits if the
+// queue is full. Works with interrupts off too, in which case the
+// writes are done by flush_eeprom_writes() (or by this function when
+// the queue is full) rather than the interrupt handler.
+void queue_eeprom_write(uint16_t address, const void* src, uint8_t length);
+
+// Whether any queued writes haven't finished
+uint8_t eeprom_writes_pending(void);
+
+// Wait until every queued write has finished
+void flush_eeprom_writes(void);
+
+#endif /* EEQUEUE_H_ */
@@ -0,0 +1,139 @@
+/*
+ * emit.c
+ *
+ * Created: 19/10/2026 6:20:07 PM
+ *  Author: Kenton
+ */
+
+#include <avr/pgmspace.h>
+
+#include "emit.h"
+#include "serialio.h"
+#include "telemetry.h"
+
+#define ESCAPE_CHAR 27
+
+static const uint16_t powers_of_ten[] PROGMEM = {10000, 1000, 100, 10};
+#define NUM_POWERS (sizeof(powers_of_ten)/sizeof(powers_of_ten[0]))
+
+uint8_t format_u16(char* buf, uint16_t n) {
+	uint8_t len = 0;
+	for (uint8_t i = 0; i < NUM_POWERS; i++) {
+		uint16_t power = pgm_read_word(&powers_of_ten[i]);
+		char digit = '0';
+		while (n >= power) {
+			n -= power;
+			digit++;
+		}
+		// Skip leading zeros
+		if (digit != '0' || len) {
+			buf[len++] = digit;
+		}
+	}
+	buf[len++] = '0' + n;
+	return len;
+}
+
+uint8_t format_u8(char* buf, uint8_t n) {
+	// Same as format_u16() with the table cut down to 8 bit powers
+	uint8_t len = 0;
+	char digit;
+	if (n >= 100) {
+		digit = '0';
+		while (n >= 100) {
+			n -= 100;
+			digit++;
+		}
+		buf[len++] = digit;
+	}
+	if (n >= 10 || len) {
+		digit = '0';
+		while (n >= 10) {
+			n -= 10;
+			digit++;
+		}
+		buf[len++] = digit;
+	}
+	buf[len++] = '0' + n;
+	return len;
+}
+
+// Everything goes through here so that it can be redirected to the
+// telemetry port (see telemetry.h)
+static inline void put(char c) {
+#if TELEMETRY
+	if (emit_to_telemetry) {
+		(void)telemetry_put_byte(c);
+		return;
+	}
+#endif
+	(void)serial_put_byte(c);
+}
+
+void emit_char(char c) {
+	put(c);
+}
+
+void emit_buffer(const char* buf, uint8_t len) {
+	while (len--) {
+		put(*buf++);
+	}
+}
+
+void emit_str(const char* s) {
+	while (*s) {
+		put(*s++);
+	}
+}
+
+void emit_P(const char* s) {
+	char c;
+	while ((c = pgm_read_byte(s++))) {
+		put(c);
+	}
+}
+
+void emit_str_padded(const char* s, uint8_t width) {
+	while (*s) {
+		put(*s++);
+		if (width) {
+			width--;
+		}
+	}
+	while (width--) {
+		put(' ');
+	}
+}
+
+void emit_u16(uint16_t n) {
+	char buf[5];
+	emit_buffer(buf, format_u16(buf, n));
+}
+
+void emit_u16_padded(uint16_t n, uint8_t width, char pad) {
+	char buf[5];
+	uint8_t len = format_u16(buf, n);
+	while (width > len) {
+		put(pad);
+		width--;
+	}
+	emit_buffer(buf, len);
+}
+
+void emit_csi_num(uint8_t n, char final) {
+	char buf[3];
+	put(ESCAPE_CHAR);
+	put('[');
+	emit_buffer(buf, format_u8(buf, n));
+	put(final);
+}
+
+void emit_csi_num2(uint8_t a, uint8_t b, char final) {
+	char buf[3];
+	put(ESCAPE_CHAR);
+	put('[');
+	emit_buffer(buf, format_u8(buf, a));
+	put(';');
+	emit_buffer(buf, format_u8(buf, b));
+	put(final);
+}
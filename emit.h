@@ -0,0 +1,71 @@
+/*
+ * emit.h
+ *
+ * Created: 19/10/2026 6:20:14 PM
+ *  Author: Kenton
+ *
+ * Minimal formatted output for hot paths. printf() goes through the
+ * full avr-libc vfprintf (parsing the format string, then writing a
+ * character at a time through the stdio stream) which costs hundreds
+ * of cycles even for a cursor move. These functions write straight
+ * into the serial output buffer (serial_put_byte(), or the telemetry
+ * port's between telemetry_begin() and telemetry_end()) and only do
+ * the formatting we actually need.
+ *
+ * Numbers are converted by repeated subtraction of powers of ten from a
+ * table rather than by division, which the AVR has no instruction for.
+ *
+ * Output from these functions and from printf() can be mixed freely
+ * (stdout is unbuffered), but note that emit_char() and friends don't
+ * translate \n into \r\n.
+ */
+
+
+#ifndef EMIT_H_
+#define EMIT_H_
+
+#include <stdint.h>
+
+// Set to 1 to build the old (printf) and new versions of each replaced
+// call site side by side, so they can be compared (see emitcmp.c).
+// "make emit-compare" in tools/simbench builds it that way and writes
+// the comparison to emit_compare_report.txt.
+#ifndef EMIT_COMPARE
+#define EMIT_COMPARE 0
+#endif
+
+// Write a single byte or len bytes from buf
+void emit_char(char c);
+void emit_buffer(const char* buf, uint8_t len);
+
+// Write a string from SRAM or from program memory
+void emit_str(const char* s);
+void emit_P(const char* s);
+
+// Write s left aligned in a field of width characters (padded with
+// spaces, never truncated)
+void emit_str_padded(const char* s, uint8_t width);
+
+// Write n in decimal, with no padding or right aligned in a field of
+// width characters padded with pad (e.g. ' ' or '0')
+void emit_u16(uint16_t n);
+void emit_u16_padded(uint16_t n, uint8_t width, char pad);
+
+// Write a control sequence with one or two numeric parameters, e.g.
+// emit_csi_num(31, 'm') writes ESC [ 3 1 m and emit_csi_num2(y, x, 'H')
+// moves the cursor.
+void emit_csi_num(uint8_t n, char final);
+void emit_csi_num2(uint8_t a, uint8_t b, char final);
+
+// Convert n to decimal in buf (not null terminated). Returns the number
+// of characters written (at most 3 and 5 respectively).
+uint8_t format_u8(char* buf, uint8_t n);
+uint8_t format_u16(char* buf, uint16_t n);
+
+#if EMIT_COMPARE
+// Time the old and new versions of each replaced call site and print a
+// table of cycles at the given terminal position (emitcmp.c)
+void emitcmp_print_comparison(uint8_t x, uint8_t y);
+#endif
+
+#endif /* EMIT_H_ */
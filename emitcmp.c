@@ -0,0 +1,163 @@
+/*
+ * emitcmp.c
+ *
+ * Created: 19/10/2026 7:02:33 PM
+ *  Author: Kenton
+ *
+ * Side by side comparison of the printf based output which emit.c
+ * replaced and the emit.c versions, for each call site that was
+ * converted. Only built when EMIT_COMPARE is set in emit.h.
+ *
+ * Cycles: press 'e' in the game to time each pair with the cycle counter
+ * (the output goes to the terminal, so there must be room in the serial
+ * output buffer - the table is printed after all of the timing).
+ *
+ * Flash: every function here is prefixed emitcmp_ and kept out of line,
+ * so avr-nm gives the size of each version (plus vfprintf's, which the
+ * old versions need).
+ *
+ * "make emit-compare" in tools/simbench does both: it builds with
+ * EMIT_COMPARE set, presses 'e' under the simulator and writes the
+ * sizes and the cycles table to emit_compare_report.txt. On the board
+ * it's a manual step - set EMIT_COMPARE, press 'e' and run avr-nm.
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "emit.h"
+
+#if EMIT_COMPARE
+
+#include "cycles.h"
+#include "terminalio.h"
+
+#define NOINLINE __attribute__((noinline))
+
+static char cmp_buffer[32];
+static const char cmp_name[] = "Kenton";
+
+// move_cursor()
+NOINLINE void emitcmp_old_move_cursor(uint8_t x, uint8_t y) {
+	printf_P(PSTR("\x1b[%d;%dH"), y, x);
+}
+NOINLINE void emitcmp_new_move_cursor(uint8_t x, uint8_t y) {
+	emit_csi_num2(y, x, 'H');
+}
+
+// s_move_cursor()
+NOINLINE uint8_t emitcmp_old_s_move_cursor(char* arr, uint8_t x, uint8_t y) {
+	sprintf_P(arr, PSTR("\x1b[%d;%dH"), y, x);
+	return 6 + (y>=10) + (x>=10);
+}
+NOINLINE uint8_t emitcmp_new_s_move_cursor(char* arr, uint8_t x, uint8_t y) {
+	return s_move_cursor(arr, x, y);
+}
+
+// s_fast_set_display_attr() (the formatting part)
+NOINLINE uint8_t emitcmp_old_s_attr(char* arr, uint8_t mode) {
+	sprintf_P(arr, PSTR("\x1b[%dm"), mode);
+	return 4 + (mode>= 10);
+}
+NOINLINE uint8_t emitcmp_new_s_attr(char* arr, uint8_t mode) {
+	uint8_t len = 2;
+	arr[0] = '\x1b';
+	arr[1] = '[';
+	len += format_u8(arr+len, mode);
+	arr[len++] = 'm';
+	return len;
+}
+
+// set_display_attribute()
+NOINLINE void emitcmp_old_set_attr(uint8_t mode) {
+	printf_P(PSTR("\x1b[%dm"), mode);
+}
+NOINLINE void emitcmp_new_set_attr(uint8_t mode) {
+	emit_csi_num(mode, 'm');
+}
+
+// print_terminal_buffer()
+NOINLINE void emitcmp_old_print_buffer(char* buf, uint8_t len) {
+	buf[len] = '\0';
+	printf("%s", buf);
+}
+NOINLINE void emitcmp_new_print_buffer(char* buf, uint8_t len) {
+	emit_buffer(buf, len);
+}
+
+// print_score()
+NOINLINE void emitcmp_old_print_score(int32_t score) {
+	printf("Score:%4lu", score);
+}
+NOINLINE void emitcmp_new_print_score(int32_t score) {
+	emit_P(PSTR("Score:"));
+	emit_u16_padded((uint16_t)score, 4, ' ');
+}
+
+// print_leaderboard() (one line)
+NOINLINE void emitcmp_old_leaderboard_line(uint8_t i, const char* name, uint16_t score) {
+	printf("%d. %-12s %4u", i+1, name, score);
+}
+NOINLINE void emitcmp_new_leaderboard_line(uint8_t i, const char* name, uint16_t score) {
+	emit_u16(i+1);
+	emit_P(PSTR(". "));
+	emit_str_padded(name, 12);
+	emit_char(' ');
+	emit_u16_padded(score, 4, ' ');
+}
+
+#define NUM_SITES 7
+static const char site_move[] PROGMEM = "move_cursor";
+static const char site_s_move[] PROGMEM = "s_move_cursor";
+static const char site_s_attr[] PROGMEM = "s_fast_set_display_attr";
+static const char site_attr[] PROGMEM = "set_display_attribute";
+static const char site_buffer[] PROGMEM = "print_terminal_buffer";
+static const char site_score[] PROGMEM = "print_score";
+static const char site_leaderboard[] PROGMEM = "print_leaderboard";
+static PGM_P const site_names[NUM_SITES] PROGMEM = {
+	site_move, site_s_move, site_s_attr, site_attr, site_buffer, site_score,
+	site_leaderboard
+};
+
+// Time a statement in cycles (the overhead of reading the counter is
+// the same for both versions so isn't subtracted)
+#define TIME(result, statement) \
+	do { \
+		uint32_t start = get_cycles(); \
+		statement; \
+		result = get_cycles() - start; \
+	} while(0)
+
+void emitcmp_print_comparison(uint8_t x, uint8_t y) {
+	uint16_t old_cycles[NUM_SITES], new_cycles[NUM_SITES];
+	uint8_t len;
+	
+	// Everything is drawn over the first line of the table, which is
+	// cleared and overwritten below.
+	TIME(old_cycles[0], emitcmp_old_move_cursor(x, y));
+	TIME(new_cycles[0], emitcmp_new_move_cursor(x, y));
+	TIME(old_cycles[1], emitcmp_old_s_move_cursor(cmp_buffer, x, y));
+	TIME(new_cycles[1], len = emitcmp_new_s_move_cursor(cmp_buffer, x, y));
+	TIME(old_cycles[2], emitcmp_old_s_attr(cmp_buffer, FG_YELLOW));
+	TIME(new_cycles[2], emitcmp_new_s_attr(cmp_buffer, FG_YELLOW));
+	TIME(old_cycles[3], emitcmp_old_set_attr(TERM_RESET));
+	TIME(new_cycles[3], emitcmp_new_set_attr(TERM_RESET));
+	TIME(old_cycles[4], emitcmp_old_print_buffer(cmp_buffer, len));
+	TIME(new_cycles[4], emitcmp_new_print_buffer(cmp_buffer, len));
+	TIME(old_cycles[5], emitcmp_old_print_score(1234));
+	TIME(new_cycles[5], emitcmp_new_print_score(1234));
+	TIME(old_cycles[6], emitcmp_old_leaderboard_line(0, cmp_name, 1234));
+	TIME(new_cycles[6], emitcmp_new_leaderboard_line(0, cmp_name, 1234));
+	
+	move_cursor(x, y);
+	printf_P(PSTR("call site                  printf   emit"));
+	clear_to_end_of_line();
+	for (uint8_t i = 0; i < NUM_SITES; i++) {
+		move_cursor(x, y+i+1);
+		printf_P(PSTR("%-24S %7u %6u"), (PGM_P)pgm_read_word(&site_names[i]),
+			old_cycles[i], new_cycles[i]);
+		clear_to_end_of_line();
+	}
+}
+
+#endif /* EMIT_COMPARE */
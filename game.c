@@ -20,6 +20,10 @@
 #include "terminalio.h"
 #include "display.h"
 #include "sound.h"
+#include "profile.h"
+#include "sram.h"
+#include "trace.h"
+#include "telemetry.h"
 
 ///////////////////////////////////////////////////////////
 // Colours
@@ -89,6 +93,9 @@ uint8_t		projectiles[MAX_PROJECTILES];
 int8_t		numAsteroids;
 uint8_t		asteroids[MAX_ASTEROIDS];
 
+SRAM_USAGE(game, sizeof(basePosition) + sizeof(numProjectiles)
+	+ sizeof(projectiles) + sizeof(numAsteroids) + sizeof(asteroids));
+
 ///////////////////////////////////////////////////////////
 // Prototypes for internal information functions 
 //  - not available outside this module.
@@ -161,7 +168,6 @@ void sort_asteroids() {
 // (2) no projectiles initially
 // (3) the maximum number of asteroids, randomly distributed.
 void initialise_game(void) {
-	reset_frame();
     basePosition = 3;
 	numProjectiles = 0;
 	numAsteroids = 0;
@@ -209,14 +215,17 @@ void add_asteroid_in_rows(uint8_t blockedRows) {
 			asteroids[i] = GAME_POSITION(x,y);
 			numAsteroids++;
 			redraw_asteroid(i, COLOUR_ASTEROID);
+			TRACE(TRACE_ASTEROID_SPAWN, asteroids[i], attempts);
 			return;
 		}
 		attempts++;
 	} while (attempts <= 8*16);
 	
 	#ifdef _ASTEROID_DEBUG
+	telemetry_begin();
 	_debug_asteroids();
 	printf("add_asteroids_in_rows");
+	telemetry_end();
 	#endif
 
 }
@@ -275,6 +284,7 @@ int8_t fire_projectile(void) {
 		new_frame();
 		newProjectileNumber = numProjectiles++;
 		projectiles[newProjectileNumber] = GAME_POSITION(basePosition, 2);
+		TRACE(TRACE_FIRE, basePosition, newProjectileNumber);
 		if (check_asteroid_hit(newProjectileNumber, asteroid_at(basePosition, 2)) != -1) {
 			redraw_projectile(newProjectileNumber, COLOUR_PROJECTILE);
 		}
@@ -290,6 +300,7 @@ int8_t fire_projectile(void) {
 void advance_projectiles(void) {
 	uint8_t x, y;
 	int8_t projectileNumber;
+	PROFILE_START(PROF_ADVANCE_PROJECTILES);
 	new_frame();
 	projectileNumber = 0;
 	s_invalidate_mode();
@@ -344,11 +355,13 @@ void advance_projectiles(void) {
 	}
 	add_missing_asteroids();
 	draw_frame();
+	PROFILE_END(PROF_ADVANCE_PROJECTILES);
 }
 
 int8_t check_asteroid_hit(int8_t projectileIndex, int8_t asteroidHit) {
 	if (projectileIndex == -1 || asteroidHit == -1)
 		return 0;
+	TRACE(TRACE_ASTEROID_HIT, asteroids[asteroidHit], projectileIndex);
 	remove_projectile(projectileIndex);
 	remove_asteroid(asteroidHit);
 	add_to_score(1);
@@ -361,6 +374,7 @@ static uint8_t check_base_hit(int8_t x, int8_t y) {
 	if (asteroid == -1)
 		return 0;
 	
+	TRACE(TRACE_BASE_HIT, asteroids[asteroid], get_lives() - 1);
 	remove_asteroid(asteroid);
 	
 	/*ledmatrix_update_pixel(LED_MATRIX_POSN_FROM_GAME_POSN(asteroids[asteroid]), COLOUR_BLACK);*/
@@ -383,7 +397,7 @@ void advance_asteroids() {
 	uint8_t i = 0;
 	uint8_t j = 0;
 	
-	
+	PROFILE_START(PROF_ADVANCE_ASTEROIDS);
 	new_frame();
 	set_display_attribute(TERM_RESET);
 	s_invalidate_mode();
@@ -416,10 +430,13 @@ void advance_asteroids() {
 	add_missing_asteroids();	
 	draw_frame();
 	redraw_base(COLOUR_BASE);
+	PROFILE_END(PROF_ADVANCE_ASTEROIDS);
 	
 	#ifdef _ASTEROID_DEBUG
+	telemetry_begin();
 	_debug_asteroids();
 	printf("advance_asteroids");
+	telemetry_end();
 	#endif
 }
 
@@ -509,6 +526,9 @@ static void remove_asteroid(int8_t asteroidNumber) {
 	/*add_asteroid_in_rows(FIELD_HEIGHT-1);*/
 
 #ifdef _ASTEROID_DEBUG
+	// Debug output goes to the telemetry port (if there is one) so it
+	// doesn't scribble over the game
+	telemetry_begin();
 	int8_t test = asteroid_at(x, y);
 	if (test != -1) {
 		printf("ASTEROID FAULT %d at (%d,%d)", test, x, y);
@@ -522,6 +542,7 @@ static void remove_asteroid(int8_t asteroidNumber) {
 	
 	_debug_asteroids();
 	printf("remove_asteroids");
+	telemetry_end();
 #endif
 }
 
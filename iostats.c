@@ -0,0 +1,155 @@
+/*
+ * iostats.c
+ *
+ * Created: 19/10/2026 1:37:45 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "iostats.h"
+#include "terminalio.h"
+#include "timer0.h"
+#include "serialio.h"
+#include "trace.h"
+#include "telemetry.h"
+
+LinkStats spi_stats;
+LinkStats uart_stats;
+volatile RxStats rx_stats;
+
+// Counter values at the start of the current frame and rate interval
+typedef struct {
+	uint32_t frame_bytes;
+	uint32_t interval_bytes;
+	uint32_t interval_blocked;
+} LinkMarks;
+
+static LinkMarks spi_marks;
+static LinkMarks uart_marks;
+static uint16_t interval_start;
+
+static uint8_t status_shown;
+
+// Take a copy of the UART counters - uart_put_char() may be called
+// from an interrupt handler (echo)
+static uint32_t uart_bytes(void) {
+	uint32_t bytes;
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	bytes = uart_stats.bytes;
+	if (interruptsOn) {
+		sei();
+	}
+	return bytes;
+}
+
+// Returns the number of bytes sent in the frame
+static uint16_t end_frame(LinkStats* s, LinkMarks* m, uint32_t bytes) {
+	uint32_t sent = bytes - m->frame_bytes;
+	if (sent > UINT16_MAX) {
+		sent = UINT16_MAX;
+	}
+	if (sent > s->frame_max) {
+		s->frame_max = sent;
+	}
+	m->frame_bytes = bytes;
+	return sent;
+}
+
+static uint8_t saturate(uint16_t n) {
+	return n > UINT8_MAX ? UINT8_MAX : n;
+}
+
+static void update_rate(LinkStats* s, LinkMarks* m, uint32_t bytes, uint16_t elapsed) {
+	uint32_t blocked = s->blocked - m->interval_blocked;
+	s->rate = (bytes - m->interval_bytes) * 1000 / elapsed;
+	// 8000 cycles per ms, so blocked*100 / (elapsed*8000)
+	s->blocked_pct = blocked / 80 / elapsed;
+	m->interval_bytes = bytes;
+	m->interval_blocked = s->blocked;
+}
+
+void reset_io_stats(void) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	spi_stats = (LinkStats){0};
+	uart_stats = (LinkStats){0};
+	rx_stats = (RxStats){0};
+	if (interruptsOn) {
+		sei();
+	}
+	spi_marks = (LinkMarks){0};
+	uart_marks = (LinkMarks){0};
+	interval_start = get_fast_time();
+}
+
+void io_stats_end_frame(void) {
+	uint16_t spi = end_frame(&spi_stats, &spi_marks, spi_stats.bytes);
+	uint16_t uart = end_frame(&uart_stats, &uart_marks, uart_bytes());
+	TRACE(TRACE_SPI_FLUSH, saturate(spi), 0);
+	TRACE(TRACE_UART_BACKLOG, serial_output_backlog(), saturate(uart));
+}
+
+void update_io_stats(void) {
+	uint16_t now = get_fast_time();
+	uint16_t elapsed = TIME_SINCE(now, interval_start);
+	if (elapsed == 0) {
+		return;
+	}
+	interval_start = now;
+	update_rate(&spi_stats, &spi_marks, spi_stats.bytes, elapsed);
+	update_rate(&uart_stats, &uart_marks, uart_bytes(), elapsed);
+	
+	if (status_shown) {
+		telemetry_begin();
+		print_io_status(X_IO_STATUS, Y_IO_STATUS);
+		telemetry_end();
+	}
+}
+
+void toggle_io_status(void) {
+	status_shown ^= 1;
+	if (status_shown) {
+		print_io_status(X_IO_STATUS, Y_IO_STATUS);
+	} else {
+		move_cursor(X_IO_STATUS, Y_IO_STATUS);
+		clear_to_end_of_line();
+		move_cursor(X_IO_STATUS, Y_IO_STATUS+1);
+		clear_to_end_of_line();
+	}
+}
+
+void print_io_status(uint8_t x, uint8_t y) {
+	set_display_attribute(TERM_RESET);
+	move_cursor(x, y);
+	printf_P(PSTR("SPI  %5u B/s %4u B/frame %3u%% blocked"),
+		spi_stats.rate, spi_stats.frame_max, spi_stats.blocked_pct);
+	clear_to_end_of_line();
+	move_cursor(x, y+1);
+	printf_P(PSTR("UART %5u B/s %4u B/frame %3u%% blocked %u waits %u lost"),
+		uart_stats.rate, uart_stats.frame_max, uart_stats.blocked_pct,
+		uart_stats.blocks, uart_stats.dropped);
+	clear_to_end_of_line();
+}
+
+void print_rx_stats(uint8_t x, uint8_t y) {
+	RxStats s;
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	s = rx_stats;
+	if (interruptsOn) {
+		sei();
+	}
+	set_display_attribute(TERM_RESET);
+	move_cursor(x, y);
+	printf_P(PSTR("RX %lu bytes, %u pause keys"), s.bytes, s.pause_keys);
+	clear_to_end_of_line();
+	move_cursor(x, y+1);
+	printf_P(PSTR("Lost: %u buffer full, %u UART overrun, %u framing"),
+		s.ring_overruns, s.uart_overruns, s.framing_errors);
+	clear_to_end_of_line();
+}
@@ -0,0 +1,68 @@
+/*
+ * iostats.h
+ *
+ * Created: 19/10/2026 1:37:52 PM
+ *  Author: Kenton
+ *
+ * Bandwidth counters for the two output links - SPI to the LED matrix
+ * and the UART to the terminal. spi.c and serialio.c count every byte
+ * sent and the time spent waiting on the link (busy waiting for the SPI
+ * transfer to finish, or for room in the full UART output buffer).
+ * draw_frame() marks the end of each frame so we can keep the largest
+ * number of bytes any one frame has pushed down each link. The
+ * terminal's input side only has counts of what was received and lost.
+ */
+
+
+#ifndef IOSTATS_H_
+#define IOSTATS_H_
+
+#include <stdint.h>
+
+// How often the byte rates are worked out (and the status line updated)
+#define IO_STATS_INTERVAL 1000
+
+typedef struct {
+	uint32_t bytes;			// bytes sent
+	uint32_t blocked;		// cycles spent waiting on the link
+	uint16_t blocks;		// number of times we had to wait (UART only)
+	uint16_t dropped;		// bytes discarded because we couldn't wait
+	uint16_t frame_max;		// most bytes sent in one frame
+	uint16_t rate;			// bytes per second over the last interval
+	uint8_t blocked_pct;	// percentage of the last interval spent waiting
+} LinkStats;
+
+extern LinkStats spi_stats;
+extern LinkStats uart_stats;
+
+// Counters for the terminal input, kept by the UART receive interrupt
+typedef struct {
+	uint32_t bytes;				// bytes received
+	uint16_t ring_overruns;		// dropped because the input buffer was full
+	uint16_t uart_overruns;		// lost because the interrupt was too late (DOR)
+	uint16_t framing_errors;	// dropped because of a framing error
+	uint16_t pause_keys;		// pause keys picked out by the interrupt
+} RxStats;
+
+extern volatile RxStats rx_stats;
+
+// Clear the counters
+void reset_io_stats(void);
+
+// Called at the end of each frame to update the per-frame maxima
+void io_stats_end_frame(void);
+
+// Periodic task (every IO_STATS_INTERVAL ms) which works out the byte
+// rates and redraws the status line if it is shown.
+void update_io_stats(void);
+
+// Turn the status line on or off
+void toggle_io_status(void);
+
+// Print the status line at the given terminal position
+void print_io_status(uint8_t x, uint8_t y);
+
+// Print the terminal input counters at the given terminal position
+void print_rx_stats(uint8_t x, uint8_t y);
+
+#endif /* IOSTATS_H_ */
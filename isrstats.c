@@ -0,0 +1,98 @@
+/*
+ * isrstats.c
+ *
+ * Created: 19/10/2026 11:15:19 AM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "isrstats.h"
+#include "terminalio.h"
+#include "timer0.h"
+
+IsrStats isr_stats[NUM_ISR_VECTORS];
+uint8_t cli_max[NUM_CLI_SITES];
+
+// When the statistics were last reset, so we can work out the load
+static uint32_t stats_start_time;
+
+static const char vec_timer0[] PROGMEM = "TIMER0_COMPA";
+static const char vec_udre[] PROGMEM = "USART0_UDRE";
+static const char vec_rx[] PROGMEM = "USART0_RX";
+static const char vec_adc[] PROGMEM = "ADC";
+static const char vec_pcint1[] PROGMEM = "PCINT1 (buttons)";
+static const char vec_pcint3[] PROGMEM = "PCINT3 (mute)";
+static const char vec_timer2[] PROGMEM = "TIMER2_OVF";
+static const char vec_udre1[] PROGMEM = "USART1_UDRE";
+static const char vec_ee_ready[] PROGMEM = "EE_READY";
+static PGM_P const vector_names[NUM_ISR_VECTORS] PROGMEM = {
+	vec_timer0, vec_udre, vec_rx, vec_adc, vec_pcint1, vec_pcint3, vec_timer2,
+	vec_udre1, vec_ee_ready
+};
+
+static const char cli_time[] PROGMEM = "get_current_time";
+static const char cli_buttons[] PROGMEM = "button_pushed";
+static const char cli_put[] PROGMEM = "uart_put_char";
+static const char cli_get[] PROGMEM = "uart_get_char";
+static PGM_P const cli_names[NUM_CLI_SITES] PROGMEM = {
+	cli_time, cli_buttons, cli_put, cli_get
+};
+
+void reset_isr_stats(void) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	cli();
+	for (uint8_t i = 0; i < NUM_ISR_VECTORS; i++) {
+		isr_stats[i].count = 0;
+		isr_stats[i].total = 0;
+		isr_stats[i].max = 0;
+	}
+	for (uint8_t i = 0; i < NUM_CLI_SITES; i++) {
+		cli_max[i] = 0;
+	}
+	if (interruptsOn) {
+		sei();
+	}
+	stats_start_time = get_current_time();
+}
+
+void print_isr_stats(uint8_t x, uint8_t y) {
+	IsrStats s;
+	uint32_t elapsed_ms = get_current_time() - stats_start_time;
+	if (elapsed_ms == 0) {
+		elapsed_ms = 1;
+	}
+	
+	set_display_attribute(TERM_RESET);
+	move_cursor(x, y);
+	printf_P(PSTR("vector                 count    cycles   max  load"));
+	clear_to_end_of_line();
+	for (uint8_t i = 0; i < NUM_ISR_VECTORS; i++) {
+		// Take a consistent copy - the handler may update it
+		cli();
+		s = isr_stats[i];
+		sei();
+		
+		// Load in hundredths of a percent. There are 8000 cycles per ms so
+		// this is (total * 8) * 10000 / (elapsed_ms * 8000).
+		uint32_t load = s.total * 10 / elapsed_ms;
+		move_cursor(x, y+i+1);
+		printf_P(PSTR("%-16S %11lu %9lu %5u %2lu.%02lu%%"),
+			(PGM_P)pgm_read_word(&vector_names[i]), s.count,
+			s.total * CYCLES_PER_COUNT, s.max * CYCLES_PER_COUNT,
+			load / 100, load % 100);
+		clear_to_end_of_line();
+	}
+	
+	move_cursor(x, y+NUM_ISR_VECTORS+1);
+	printf_P(PSTR("longest cli() window (cycles):"));
+	clear_to_end_of_line();
+	for (uint8_t i = 0; i < NUM_CLI_SITES; i++) {
+		move_cursor(x, y+NUM_ISR_VECTORS+2+i);
+		printf_P(PSTR("  %-16S %5u"), (PGM_P)pgm_read_word(&cli_names[i]),
+			cli_max[i] * CYCLES_PER_COUNT);
+		clear_to_end_of_line();
+	}
+}
@@ -0,0 +1,94 @@
+/*
+ * isrstats.h
+ *
+ * Created: 19/10/2026 11:15:26 AM
+ *  Author: Kenton
+ *
+ * Interrupt load accounting. Each interrupt handler is wrapped in
+ * ISR_STATS_ENTER() / ISR_STATS_EXIT(vector) which count invocations
+ * and the cycles spent in the handler. Sections of code which disable
+ * interrupts are wrapped in CLI_STATS_ENTER() / CLI_STATS_EXIT(site)
+ * which track the longest time interrupts were masked at that site.
+ *
+ * Timing uses timer 2 (see cycles.h) directly - only the 8 bit count
+ * is read, which is cheap enough for interrupt handlers but limits a
+ * single measurement to 2047 cycles (anything longer wraps around).
+ * Times include the few cycles of handler prologue/epilogue that the
+ * compiler adds outside our markers.
+ * Set ISR_STATS to 0 to compile the accounting out.
+ */
+
+
+#ifndef ISRSTATS_H_
+#define ISRSTATS_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "cycles.h"
+
+#define ISR_STATS 1
+
+// Interrupt vectors we account for
+#define ISR_TIMER0_COMPA	0
+#define ISR_USART0_UDRE		1
+#define ISR_USART0_RX		2
+#define ISR_ADC				3
+#define ISR_PCINT1			4
+#define ISR_PCINT3			5
+#define ISR_TIMER2_OVF		6
+#define ISR_USART1_UDRE		7	// telemetry.c (only with TELEMETRY on)
+#define ISR_EE_READY		8	// eequeue.c
+#define NUM_ISR_VECTORS		9
+
+// Places where interrupts are disabled
+#define CLI_GET_CURRENT_TIME	0
+#define CLI_BUTTON_PUSHED		1
+#define CLI_UART_PUT_CHAR		2
+#define CLI_UART_GET_CHAR		3
+#define NUM_CLI_SITES			4
+
+typedef struct {
+	uint32_t count;
+	uint32_t total;		// in timer 2 counts (CYCLES_PER_COUNT cycles)
+	uint8_t max;
+} IsrStats;
+
+extern IsrStats isr_stats[NUM_ISR_VECTORS];
+extern uint8_t cli_max[NUM_CLI_SITES];
+
+#if ISR_STATS
+#define ISR_STATS_ENTER()		uint8_t isr_stats_start = TCNT2
+#define ISR_STATS_EXIT(vector)	isr_stats_record((vector), TCNT2 - isr_stats_start)
+#define CLI_STATS_ENTER()		uint8_t cli_stats_start = TCNT2
+#define CLI_STATS_EXIT(site)	cli_stats_record((site), TCNT2 - cli_stats_start)
+#else
+#define ISR_STATS_ENTER()
+#define ISR_STATS_EXIT(vector)
+#define CLI_STATS_ENTER()
+#define CLI_STATS_EXIT(site)
+#endif
+
+// Called from interrupt handlers (interrupts off) so no locking needed
+static inline void isr_stats_record(uint8_t vector, uint8_t counts) {
+	IsrStats* s = &isr_stats[vector];
+	s->count++;
+	s->total += counts;
+	if (counts > s->max) {
+		s->max = counts;
+	}
+}
+
+static inline void cli_stats_record(uint8_t site, uint8_t counts) {
+	if (counts > cli_max[site]) {
+		cli_max[site] = counts;
+	}
+}
+
+// Clear all of the statistics
+void reset_isr_stats(void);
+
+// Print a table of per vector statistics and the longest interrupts
+// disabled windows at the given terminal position.
+void print_isr_stats(uint8_t x, uint8_t y);
+
+#endif /* ISRSTATS_H_ */
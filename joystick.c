@@ -8,7 +8,8 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
-#define DEAD_RADIUS 200
+#include "isrstats.h"
+#include "settings.h"
 
 uint16_t value;
 uint8_t adc_xy = 0;	/* 0 = x, 1 = y */
@@ -50,14 +51,16 @@ void init_joystick() {
 }
 
 ISR(ADC_vect) {
+	ISR_STATS_ENTER();
 	uint16_t value = ADC;
+	uint16_t dead_radius = SETTING(SET_DEAD_RADIUS);
 	if (adc_xy) {
-		if (value < x_centre-DEAD_RADIUS || value > x_centre+DEAD_RADIUS) {
+		if (value < x_centre-dead_radius || value > x_centre+dead_radius) {
 			last_x = value > x_centre ? 2 : 4;
 		} else {
 			last_x = 0;
 		}
-	} else if (value < y_centre-DEAD_RADIUS || value > y_centre+DEAD_RADIUS) {
+	} else if (value < y_centre-dead_radius || value > y_centre+dead_radius) {
 		last_y = value > y_centre ? 1 : 3;
 	} else {
 		last_y = 0;
@@ -69,6 +72,7 @@ ISR(ADC_vect) {
 		ADMUX |= 1;
 	}
 	ADCSRA |= (1<<ADSC);
+	ISR_STATS_EXIT(ISR_ADC);
 }
 
 uint8_t get_joystick_input() {
@@ -0,0 +1,290 @@
+/*
+ * keys.c
+ *
+ * Created: 18/10/2026 10:12:33 AM
+ *  Author: Kenton
+ *
+ * Table driven decoder for the serial input stream. Each byte is
+ * classified, and the (state, class) pair is looked up in a transition
+ * table which gives the action to take and the next state. This
+ * replaces the separate three-state ESC [ X parsers which used to live
+ * in project.c and leaderboard.c and which only understood 3-byte
+ * sequences.
+ */
+
+#include <avr/pgmspace.h>
+
+#include "keys.h"
+#include "serialio.h"
+#include "timer0.h"
+#include "sram.h"
+
+#define ESCAPE_CHAR 27
+
+// An escape which isn't followed by another byte within this many
+// milliseconds is reported as KEY_ESCAPE. A CSI or SS3 sequence which
+// isn't finished this long after its ESC (e.g. its last byte was lost
+// to an overrun) is discarded, so it can't swallow the keys typed after
+// it. A whole sequence takes a few milliseconds even at 9600 baud.
+#define ESCAPE_TIMEOUT 50
+
+// Decoder states
+#define S_GROUND	0	// not in a sequence
+#define S_ESC		1	// seen ESC
+#define S_CSI		2	// seen ESC [
+#define S_SS3		3	// seen ESC O
+#define NUM_STATES	4
+
+// Byte classes
+#define C_ESC		0	// escape
+#define C_CSI		1	// [
+#define C_SS3		2	// O
+#define C_DIGIT		3	// 0 to 9
+#define C_SEP		4	// ;
+#define C_FINAL		5	// other bytes which can end a sequence (0x40 to 0x7e)
+#define C_CTRL		6	// control characters
+#define C_OTHER		7	// anything else
+#define NUM_CLASSES	8
+
+// Actions
+#define A_NONE		0	// just change state
+#define A_CHAR		1	// emit the byte as an ordinary character
+#define A_START		2	// start of CSI/SS3 sequence - clear parameters
+#define A_DIGIT		3	// accumulate parameter digit
+#define A_SEP		4	// move on to the next parameter
+#define A_CSI		5	// dispatch completed CSI sequence
+#define A_SS3		6	// dispatch completed SS3 sequence
+#define A_ESC		7	// emit KEY_ESCAPE
+#define A_ESC_CHAR	8	// emit KEY_ESCAPE followed by the byte as a character
+#define A_ABORT		9	// discard the sequence
+
+#define T(action, state) (((action) << 2) | (state))
+
+static const uint8_t transitions[NUM_STATES][NUM_CLASSES] PROGMEM = {
+	/*			C_ESC				C_CSI				C_SS3				C_DIGIT				C_SEP				C_FINAL				C_CTRL				C_OTHER */
+	/* GROUND */
+	{	T(A_NONE, S_ESC),	T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND),T(A_CHAR, S_GROUND) },
+	/* ESC */
+	{	T(A_ESC, S_ESC),	T(A_START, S_CSI),	T(A_START, S_SS3),	T(A_ESC_CHAR, S_GROUND),T(A_ESC_CHAR, S_GROUND),T(A_ESC_CHAR, S_GROUND),T(A_ESC_CHAR, S_GROUND),T(A_ESC_CHAR, S_GROUND) },
+	/* CSI */
+	{	T(A_NONE, S_ESC),	T(A_CSI, S_GROUND),	T(A_CSI, S_GROUND),	T(A_DIGIT, S_CSI),	T(A_SEP, S_CSI),	T(A_CSI, S_GROUND),	T(A_CHAR, S_GROUND),T(A_NONE, S_CSI) },
+	/* SS3 */
+	{	T(A_NONE, S_ESC),	T(A_SS3, S_GROUND),	T(A_SS3, S_GROUND),	T(A_DIGIT, S_SS3),	T(A_ABORT, S_GROUND),T(A_SS3, S_GROUND),T(A_CHAR, S_GROUND),T(A_ABORT, S_GROUND) },
+};
+
+// Final bytes of CSI/SS3 sequences and the keys they correspond to.
+// (Index i in final_chars gives key KEY_UP+final_keys[i].)
+static const char final_chars[] PROGMEM = "ABCDHFPQRS";
+static const uint8_t final_keys[] PROGMEM = {
+	KEY_UP-KEY_UP, KEY_DOWN-KEY_UP, KEY_RIGHT-KEY_UP, KEY_LEFT-KEY_UP,
+	KEY_HOME-KEY_UP, KEY_END-KEY_UP,
+	KEY_F1-KEY_UP, KEY_F2-KEY_UP, KEY_F3-KEY_UP, KEY_F4-KEY_UP
+};
+
+// Keys for ESC [ n ~ sequences, indexed by n. 0xff for unused numbers.
+#define NUM_TILDE_KEYS 15
+static const uint8_t tilde_keys[NUM_TILDE_KEYS] PROGMEM = {
+	0xff, KEY_HOME-KEY_UP, KEY_INSERT-KEY_UP, KEY_DELETE-KEY_UP, KEY_END-KEY_UP,
+	KEY_PAGE_UP-KEY_UP, KEY_PAGE_DOWN-KEY_UP, KEY_HOME-KEY_UP, KEY_END-KEY_UP,
+	0xff, 0xff, KEY_F1-KEY_UP, KEY_F2-KEY_UP, KEY_F3-KEY_UP, KEY_F4-KEY_UP
+};
+
+// Decoder state. Sequences have at most two numeric parameters that we
+// care about (key number and modifier) - any more are ignored.
+#define MAX_PARAMS 2
+static uint8_t state;
+static uint8_t params[MAX_PARAMS];
+static uint8_t param_num;
+static uint16_t escape_time;	// when the current sequence's ESC arrived
+
+// Queue of decoded key events. Circular buffer in the same style as the
+// serial input buffer.
+#define KEY_QUEUE_SIZE 8
+static int16_t key_queue[KEY_QUEUE_SIZE];
+static uint8_t key_insert_pos;
+static uint8_t keys_in_queue;
+
+SRAM_USAGE(keys, sizeof(state) + sizeof(params) + sizeof(param_num)
+	+ sizeof(escape_time) + sizeof(key_queue) + sizeof(key_insert_pos)
+	+ sizeof(keys_in_queue));
+
+static void queue_key(int16_t key) {
+	if (keys_in_queue >= KEY_QUEUE_SIZE) {
+		return;
+	}
+	key_queue[key_insert_pos++] = key;
+	keys_in_queue++;
+	if (key_insert_pos == KEY_QUEUE_SIZE) {
+		key_insert_pos = 0;
+	}
+}
+
+static uint8_t classify(uint8_t c) {
+	if (c == ESCAPE_CHAR) {
+		return C_ESC;
+	} else if (c == '[') {
+		return C_CSI;
+	} else if (c == 'O') {
+		return C_SS3;
+	} else if (c >= '0' && c <= '9') {
+		return C_DIGIT;
+	} else if (c == ';') {
+		return C_SEP;
+	} else if (c >= 0x40 && c <= 0x7e) {
+		return C_FINAL;
+	} else if (c < 0x20 || c == 0x7f) {
+		return C_CTRL;
+	}
+	return C_OTHER;
+}
+
+// xterm encodes modifiers as 1 + (shift) + 2*(alt) + 4*(ctrl)
+static int16_t modifiers(uint8_t param) {
+	if (param < 2) {
+		return 0;
+	}
+	return (int16_t)((param - 1) & 0x07) << 12;
+}
+
+static int16_t final_key(uint8_t final) {
+	for (uint8_t i = 0; i < sizeof(final_keys); i++) {
+		if (pgm_read_byte(&final_chars[i]) == final) {
+			return KEY_UP + pgm_read_byte(&final_keys[i]);
+		}
+	}
+	return KEY_UNKNOWN;
+}
+
+static void dispatch_csi(uint8_t final) {
+	int16_t key = KEY_UNKNOWN;
+	if (final == '~') {
+		if (params[0] < NUM_TILDE_KEYS && pgm_read_byte(&tilde_keys[params[0]]) != 0xff) {
+			key = KEY_UP + pgm_read_byte(&tilde_keys[params[0]]);
+		}
+	} else {
+		key = final_key(final);
+	}
+	if (key != KEY_UNKNOWN) {
+		key |= modifiers(params[1]);
+	}
+	queue_key(key);
+}
+
+static void dispatch_ss3(uint8_t final) {
+	int16_t key = final_key(final);
+	if (key != KEY_UNKNOWN) {
+		key |= modifiers(params[0]);
+	}
+	queue_key(key);
+}
+
+static void decode_byte(uint8_t c) {
+	uint8_t entry = pgm_read_byte(&transitions[state][classify(c)]);
+	state = entry & 0x03;
+
+	switch (entry >> 2) {
+		case A_CHAR:
+			queue_key(c);
+			break;
+		case A_START:
+			params[0] = 0;
+			params[1] = 0;
+			param_num = 0;
+			break;
+		case A_DIGIT:
+			if (params[param_num] < 25) {
+				params[param_num] = params[param_num]*10 + (c - '0');
+			} else {
+				params[param_num] = 0xff; // saturate - not a key we know
+			}
+			break;
+		case A_SEP:
+			if (param_num < MAX_PARAMS-1) {
+				param_num++;
+			}
+			break;
+		case A_CSI:
+			dispatch_csi(c);
+			break;
+		case A_SS3:
+			dispatch_ss3(c);
+			break;
+		case A_ESC:
+			queue_key(KEY_ESCAPE);
+			break;
+		case A_ESC_CHAR:
+			queue_key(KEY_ESCAPE);
+			queue_key(c);
+			break;
+		case A_NONE:
+		case A_ABORT:
+		default:
+			break;
+	}
+
+	// Every sequence starts with ESC, so this times the whole sequence.
+	// (Timing from its latest byte instead would let a steady stream of
+	// e.g. spaces keep a broken sequence going for ever.)
+	if (state == S_ESC) {
+		escape_time = get_fast_time();
+	}
+}
+
+// End a sequence which has timed out
+static void check_timeout(void) {
+	if (state != S_GROUND && keys_in_queue < KEY_QUEUE_SIZE
+			&& TIME_SINCE(get_fast_time(), escape_time) > ESCAPE_TIMEOUT) {
+		if (state == S_ESC) {
+			// Escape on its own
+			queue_key(KEY_ESCAPE);
+		}
+		// (An unfinished CSI/SS3 sequence is just dropped)
+		state = S_GROUND;
+	}
+}
+
+void init_keys(void) {
+	state = S_GROUND;
+	key_insert_pos = 0;
+	keys_in_queue = 0;
+}
+
+void poll_keys(void) {
+	// A sequence which timed out since the last call mustn't take the
+	// bytes which have arrived since
+	check_timeout();
+	
+	// Take the input a burst at a time straight from the serial input
+	// buffer. A byte can produce at most two key events, so only take
+	// as many bytes as there is room for. Anything left over stays in
+	// the serial input buffer until the next call.
+	uint8_t bytes[KEY_QUEUE_SIZE/2];
+	uint8_t n;
+	while ((n = serial_read_bytes(bytes, (KEY_QUEUE_SIZE - keys_in_queue)/2)) > 0) {
+		for (uint8_t i = 0; i < n; i++) {
+			decode_byte(bytes[i]);
+		}
+	}
+
+	check_timeout();
+}
+
+int16_t key_pressed(void) {
+	int16_t key;
+	if (keys_in_queue == 0) {
+		return KEY_NONE;
+	}
+	if (key_insert_pos < keys_in_queue) {
+		// Need to wrap around
+		key = key_queue[key_insert_pos - keys_in_queue + KEY_QUEUE_SIZE];
+	} else {
+		key = key_queue[key_insert_pos - keys_in_queue];
+	}
+	keys_in_queue--;
+	return key;
+}
+
+void clear_keys(void) {
+	clear_serial_input_buffer();
+	init_keys();
+}
@@ -0,0 +1,65 @@
+/*
+ * keys.h
+ *
+ * Created: 18/10/2026 10:12:41 AM
+ *  Author: Kenton
+ *
+ * Decodes the serial input stream into key events. Plain characters
+ * are passed through unchanged; terminal escape sequences (CSI sequences
+ * such as ESC [ A or ESC [ 1 ; 5 C and SS3 sequences such as ESC O P) are
+ * turned into the KEY_ codes below. Each call to poll_keys() consumes
+ * every byte waiting in the serial input buffer so that multi-byte keys
+ * can't overrun it.
+ */
+
+
+#ifndef KEYS_H_
+#define KEYS_H_
+
+#include <stdint.h>
+
+// Returned by key_pressed() when no key events are waiting
+#define KEY_NONE (-1)
+
+// Key codes for keys which arrive as escape sequences. Ordinary
+// characters (including '\n' for enter, '\b' and 0x7f for backspace)
+// are returned as their ASCII value so these start above 0xff.
+#define KEY_UP			0x100
+#define KEY_DOWN		0x101
+#define KEY_RIGHT		0x102
+#define KEY_LEFT		0x103
+#define KEY_HOME		0x104
+#define KEY_END			0x105
+#define KEY_INSERT		0x106
+#define KEY_DELETE		0x107
+#define KEY_PAGE_UP		0x108
+#define KEY_PAGE_DOWN	0x109
+#define KEY_F1			0x10A
+#define KEY_F2			0x10B
+#define KEY_F3			0x10C
+#define KEY_F4			0x10D
+#define KEY_ESCAPE		0x10E	// escape on its own (not starting a sequence)
+#define KEY_UNKNOWN		0x10F	// well formed sequence we don't have a code for
+
+// Modifier flags, as reported by xterm style sequences (ESC [ 1 ; m X).
+// These are ORed into the key code - use KEY_CODE() to strip them.
+#define KEY_MOD_SHIFT	0x1000
+#define KEY_MOD_ALT		0x2000
+#define KEY_MOD_CTRL	0x4000
+#define KEY_CODE(key)	((key) & 0x0FFF)
+
+// Reset the decoder and discard any queued key events.
+void init_keys(void);
+
+// Read all available serial input through the decoder, queueing any
+// completed key events. Should be called regularly from the main loop.
+void poll_keys(void);
+
+// Return the next decoded key event, or KEY_NONE if there are none.
+int16_t key_pressed(void);
+
+// Discard queued key events, partially decoded sequences and any
+// unread serial input.
+void clear_keys(void);
+
+#endif /* KEYS_H_ */
@@ -0,0 +1,44 @@
+/*
+ * latency.h
+ *
+ * Created: 20/10/2026 4:48:10 PM
+ *  Author: Kenton
+ *
+ * Scope hook for measuring input to display latency on the board. With
+ * LATENCY_PIN set to 1 (here or with -DLATENCY_PIN=1), pin D6 toggles
+ * when the first LED matrix pixel is lit after a move or fire input has
+ * been acted on. Put one probe on the button (or the RX line for keys)
+ * and one on D6; the latency is the time from the input edge to the
+ * next D6 edge. Inputs which don't draw anything (e.g. moving into the
+ * edge) leave D6 alone.
+ * tools/simbench measures the same thing under simavr without this.
+ */
+
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#ifndef LATENCY_PIN
+#define LATENCY_PIN 0
+#endif
+
+#if LATENCY_PIN
+extern uint8_t latency_armed;
+
+#define LATENCY_INIT()		(DDRD |= (1<<DDRD6))
+#define LATENCY_ARM()		(latency_armed = 1)
+#define LATENCY_DISARM()	(latency_armed = 0)
+// Writing a 1 to PIND toggles the pin
+#define LATENCY_SHOWN() \
+	do { if (latency_armed) { PIND = (1<<PIND6); latency_armed = 0; } } while(0)
+#else
+#define LATENCY_INIT()
+#define LATENCY_ARM()
+#define LATENCY_DISARM()
+#define LATENCY_SHOWN()
+#endif
+
+#endif /* LATENCY_H_ */
@@ -9,44 +9,109 @@
 #include <avr/eeprom.h>
 #include <avr/io.h>
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include "terminalio.h"
 #include "serialio.h"
+#include "keys.h"
+#include "leaderboard.h"
+#include "sram.h"
+#include "arena.h"
+#include "emit.h"
+#include "eequeue.h"
+#include "settings.h"
 
+#include <util/crc16.h>
+
+// The old fixed table, only read to carry it over into the journal
 #define EEPROM_SIG 0xfade
 #define SIG_ADDRESS (uint16_t *)20
 #define SCORES_START (uint16_t *)40
 #define NAMES_START (void *)60
+
 #define MAX_LEADERBOARD 5
 #define NAME_LEN 12
 
-#define ESCAPE_CHAR 27
 #define MISSING 0xefff
 
+// The journal - clear of the old table and below the settings
+#define JOURNAL_START 0x80
+#define JOURNAL_SLOTS 40
+#define SLOT_ADDRESS(slot) (JOURNAL_START + (uint16_t)(slot)*sizeof(JournalRecord))
+
+// Sequence number of an erased slot
+#define EMPTY_SEQ 0xFFFFFFFF
+
+typedef struct __attribute__((packed)) {
+	uint32_t seq;			// one more than the record written before it
+	uint16_t score;
+	char name[NAME_LEN];	// not NUL terminated if it's the full length
+	uint8_t crc;			// CRC-8 (CCITT) of everything before it
+} JournalRecord;
+
+typedef char journal_fits[SLOT_ADDRESS(JOURNAL_SLOTS) <= SETTINGS_EEPROM_ADDRESS ? 1 : -1];
+
 typedef struct afdjskl {
 	uint16_t score;
 	char name[NAME_LEN+1];	
+	uint32_t seq;			// of its journal record (breaks ties - newer is higher)
+	uint8_t slot;			// journal slot holding it
 } HighScore;
 
 HighScore highscores[MAX_LEADERBOARD];
 
 uint8_t numScores = 0;
 
-void write_leaderboard(void) {
-	for (uint8_t i = 0; i < MAX_LEADERBOARD; i++) {
-		if (i >= numScores) {
-			highscores[i].score = MISSING;
-			strcpy(highscores[i].name, "--INVALIDx--");
+// Where the next record goes and its sequence number
+static uint8_t journal_head;
+static uint32_t next_seq;
+
+// The record being written. It's written in the background so it has to
+// stay put until the write finishes.
+static JournalRecord record;
+
+static uint8_t record_crc(const JournalRecord* r) {
+	uint8_t crc = 0;
+	const uint8_t* p = (const uint8_t*)r;
+	for (uint8_t i = 0; i < offsetof(JournalRecord, crc); i++) {
+		crc = _crc8_ccitt_update(crc, p[i]);
+	}
+	return crc;
+}
+
+static uint8_t ranks_below(const HighScore* a, const HighScore* b) {
+	return a->score < b->score || (a->score == b->score && a->seq < b->seq);
+}
+
+static uint8_t slot_in_use(uint8_t slot) {
+	for (uint8_t i = 0; i < numScores; i++) {
+		if (highscores[i].slot == slot) {
+			return 1;
 		}
-		eeprom_write_word(SCORES_START+2*i, highscores[i].score);
-		eeprom_write_block(highscores[i].name, (void*)(NAMES_START+NAME_LEN*i), 12);
 	}
+	return 0;
 }
 
-static void reset_eeprom(void) {
-	numScores = 0;
-	write_leaderboard();
-	eeprom_write_word(SIG_ADDRESS, EEPROM_SIG);
+// Append entry i to the journal. The slots holding the rest of the
+// leaderboard are passed over, so the only record a write can damage
+// is one which no longer counts.
+static void journal_append(uint8_t i) {
+	// The record from the last append might not have gone yet
+	flush_eeprom_writes();
+	
+	uint8_t slot = journal_head;
+	while (slot_in_use(slot)) {
+		slot = (slot + 1) % JOURNAL_SLOTS;
+	}
+	highscores[i].seq = next_seq++;
+	highscores[i].slot = slot;
+	journal_head = (slot + 1) % JOURNAL_SLOTS;
+	
+	record.seq = highscores[i].seq;
+	record.score = highscores[i].score;
+	memcpy(record.name, highscores[i].name, NAME_LEN);
+	record.crc = record_crc(&record);
+	queue_eeprom_write(SLOT_ADDRESS(slot), &record, sizeof(record));
 }
 
 void print_leaderboard(uint8_t x, uint8_t y) {
@@ -54,8 +119,11 @@ void print_leaderboard(uint8_t x, uint8_t y) {
 	printf_P(PSTR("LEADERBOARD"));
 	for (uint8_t i = 0; i < numScores; i++) {
 		move_cursor(x, y+i+1);
-		printf("%d. %-12s %4u", i+1, 
-			highscores[numScores-i-1].name, highscores[numScores-i-1].score);
+		emit_u16(i+1);
+		emit_P(PSTR(". "));
+		emit_str_padded(highscores[numScores-i-1].name, NAME_LEN);
+		emit_char(' ');
+		emit_u16_padded(highscores[numScores-i-1].score, 4, ' ');
 	}
 	for (uint8_t n = 0; n < MAX_LEADERBOARD-numScores; n++) {
 		move_cursor(x, y+n+1+numScores);
@@ -63,18 +131,87 @@ void print_leaderboard(uint8_t x, uint8_t y) {
 	}
 }
 
-void init_leaderboard(void) {
-	uint16_t signature = eeprom_read_word(SIG_ADDRESS);
-	if (signature != EEPROM_SIG) {
-		reset_eeprom();
+// Add an entry to the leaderboard in RAM, keeping it sorted. Returns
+// its index, or -1 if it didn't make it.
+static int8_t add_entry(uint16_t score, const char* name, uint32_t seq) {
+	HighScore entry;
+	entry.score = score;
+	memcpy(entry.name, name, NAME_LEN);
+	entry.name[NAME_LEN] = '\0';
+	entry.seq = seq;
+	entry.slot = JOURNAL_SLOTS;	// not in the journal yet
+	
+	uint8_t i;
+	if (numScores < MAX_LEADERBOARD) {
+		i = numScores++;
+	} else if (ranks_below(&highscores[0], &entry)) {
+		i = 0;	// replaces the lowest
+	} else {
+		return -1;
+	}
+	// Move it up past anything it beats (an insertion sort step)
+	while (i+1 < numScores && ranks_below(&highscores[i+1], &entry)) {
+		highscores[i] = highscores[i+1];
+		i++;
+	}
+	while (i > 0 && ranks_below(&entry, &highscores[i-1])) {
+		highscores[i] = highscores[i-1];
+		i--;
+	}
+	highscores[i] = entry;
+	return i;
+}
+
+// Bring the old fixed table over into the (empty) journal
+static void import_old_table(void) {
+	if (eeprom_read_word(SIG_ADDRESS) != EEPROM_SIG) {
+		return;
 	}
+	for (uint8_t i = 0; i < MAX_LEADERBOARD; i++) {
+		char old_name[NAME_LEN];
+		uint16_t score = eeprom_read_word(SCORES_START+2*i);
+		eeprom_read_block(old_name, (void*)(NAMES_START+NAME_LEN*i), NAME_LEN);
+		if (score != MISSING) {
+			int8_t added = add_entry(score, old_name, next_seq);
+			if (added >= 0) {
+				journal_append(added);
+			}
+		}
+	}
+	flush_eeprom_writes();
+}
+
+// Rebuild the leaderboard from the journal. Every slot is read once, so
+// this takes the same (short) time however the journal was left.
+void init_leaderboard(void) {
 	numScores = 0;
 	for (uint8_t i = 0; i < MAX_LEADERBOARD; i++) {
-		highscores[i].score = eeprom_read_word(SCORES_START+2*i);
-		if (highscores[i].score != MISSING) {
-			numScores++;
+		highscores[i].score = MISSING;
+	}
+	journal_head = 0;
+	next_seq = 0;
+	
+	flush_eeprom_writes();
+	uint8_t found = 0;
+	for (uint8_t slot = 0; slot < JOURNAL_SLOTS; slot++) {
+		JournalRecord r;
+		eeprom_read_block(&r, (const void*)SLOT_ADDRESS(slot), sizeof(r));
+		// Erased slots and damaged records (a write cut short) are skipped
+		if (r.seq == EMPTY_SEQ || r.crc != record_crc(&r)) {
+			continue;
+		}
+		found = 1;
+		if (r.seq >= next_seq) {
+			next_seq = r.seq + 1;
+			journal_head = (slot + 1) % JOURNAL_SLOTS;
 		}
-		eeprom_read_block(highscores[i].name, (void*)(NAMES_START+NAME_LEN*i), NAME_LEN);
+		int8_t added = add_entry(r.score, r.name, r.seq);
+		if (added >= 0) {
+			highscores[added].slot = slot;
+		}
+	}
+	if (!found) {
+		import_old_table();
 	}
 }
 
@@ -88,102 +225,70 @@ uint8_t made_leaderboard(uint16_t new_score) {
 	return 0;
 }
 
-void sort_leaderboard() {
-	uint8_t i, j;
-	HighScore temp;
-	// from https://www.geeksforgeeks.org/insertion-sort/
-	for (i = 1; i < numScores; i++) {
-		/* invariant:  array[0..i-1] is sorted */
-		j = i;
-		/* customization bug: SWAP is not used here */
-		temp = highscores[j];
-		while (j > 0 && (highscores[j-1].score > temp.score)) {
-			highscores[j] = highscores[j-1];
-			j--;
-		}
-		highscores[j] = temp;
-	}
-}
+// Name being entered by ask_name(). These are static (rather than local)
+// so they survive ask_name() returning while it waits for keys. The name
+// buffer is borrowed from the arena for the game over phase.
+static char* name;
+static uint8_t c_num;
 
-void ask_name(uint16_t score) {
-	char name[NAME_LEN+1] = {0};	
-	uint8_t c_num = 0;
+ARENA_CHECK(name_fits, NAME_LEN+1 <= NAME_BUFFER_SIZE);
+
+SRAM_USAGE(leaderboard, sizeof(highscores) + sizeof(numScores)
+	+ sizeof(journal_head) + sizeof(next_seq) + sizeof(record) + sizeof(name)
+	+ sizeof(c_num));
+
+PT_THREAD(ask_name(struct pt* pt, uint16_t score)) {
+	int16_t key;
 	
-	char serial_input = -1;
-	char escape_sequence_char = -1;
-	uint8_t characters_into_escape_sequence = 0;
+	PT_BEGIN(pt);
+	
+	name = arena_alloc(NAME_BUFFER_SIZE);
+	memset(name, 0, NAME_BUFFER_SIZE);
+	c_num = 0;
 	
 	show_cursor();
-	clear_serial_input_buffer();
+	clear_keys();
 	printf_P(PSTR("____________\b\b\b\b\b\b\b\b\b\b\b\b"));
 #ifndef _LOOP_FOR_NAME
 	while (1) {
-		escape_sequence_char = -1;
-		if(serial_input_available()) {
-			// Serial data was available - read the data from standard input
-			serial_input = fgetc(stdin);
-			/*printf("%d,", serial_input);*/
-			// Check if the character is part of an escape sequence
-			if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-				// We've hit the first character in an escape sequence (escape)
-				characters_into_escape_sequence++;
-				serial_input = -1; // Don't further process this character
-			} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-				// We've hit the second character in an escape sequence
-				characters_into_escape_sequence++;
-				serial_input = -1; // Don't further process this character
-			} else if(characters_into_escape_sequence == 2) {
-				// Third (and last) character in the escape sequence
-				escape_sequence_char = serial_input;
-				serial_input = -1;  // Don't further process this character - we
-				// deal with it as part of the escape sequence
-				characters_into_escape_sequence = 0;
-			} else {
-				// Character was not part of an escape sequence (or we received
-				// an invalid second character in the sequence). We'll process
-				// the data in the serial_input variable.
-				characters_into_escape_sequence = 0;
-			}
-			
-			if (serial_input == 0x7f || serial_input == 0x8) { // backspace
-				if (c_num > 0) {
-					
-					c_num--;
-					name[c_num] = '\0';
-					printf_P(PSTR("\b_\b"));
-				}
-				continue;
+		// (key is set when the wait finishes so is valid until the next wait)
+		PT_WAIT_UNTIL(pt, (poll_keys(), (key = key_pressed()) != KEY_NONE));
+		
+		if (key == 0x7f || key == 0x8) { // backspace
+			if (c_num > 0) {
+				
+				c_num--;
+				name[c_num] = '\0';
+				printf_P(PSTR("\b_\b"));
 			}
-			if (serial_input == '\n') { // enter was pressed
-				break;
-			}
-			
-			if (c_num >= NAME_LEN) {
-				continue;
-			}
-			
-			if (('a' <= serial_input && serial_input <= 'z')
-				|| ('A' <= serial_input && serial_input <= 'Z')
-				|| (serial_input == ' ')) {
-				printf_P(PSTR("%c"), serial_input);
-				name[c_num++] = serial_input;
-				continue;
-			}
-			
-			if (0 && escape_sequence_char) {}
-			
+			continue;
+		}
+		if (key == '\n') { // enter was pressed
+			break;
 		}
+		
+		if (c_num >= NAME_LEN) {
+			continue;
+		}
+		
+		if (('a' <= key && key <= 'z')
+			|| ('A' <= key && key <= 'Z')
+			|| (key == ' ')) {
+			printf_P(PSTR("%c"), key);
+			name[c_num++] = key;
+			continue;
+		}
+		
+		// Anything else (including cursor keys) is ignored
 	}
 #endif
 
-	uint8_t pos = numScores < MAX_LEADERBOARD ? numScores : 0;
-
-	highscores[pos].score = score;
-	strcpy(highscores[pos].name, name);
-	if (numScores < MAX_LEADERBOARD) {
-		numScores++;
-	}
 	hide_cursor();
-	sort_leaderboard();
-	write_leaderboard();
+	// One record is written (in the background) for the new entry
+	int8_t added = add_entry(score, name, next_seq);
+	if (added >= 0) {
+		journal_append(added);
+	}
+	
+	PT_END(pt);
 }
\ No newline at end of file
@@ -3,17 +3,37 @@
  *
  * Created: 21/05/2019 11:08:17 AM
  *  Author: Kenton
+ *
+ * The top five scores, kept in EEPROM as a journal rather than a fixed
+ * table. Each new high score appends one record (sequence number,
+ * score, name and CRC-8) to the next free slot of a ring of slots, so
+ * writes are spread over the whole ring and no update rewrites the
+ * table. The leaderboard is the top five of all the valid records.
+ *
+ * Slots holding the current top five are passed over when the ring
+ * wraps, and every other slot holds a record which can never make the
+ * top five again, so a write only ever overwrites a record which no
+ * longer counts. If power is lost part way through, the damaged record
+ * fails its CRC and the leaderboard is as it was before. At start up
+ * every slot is read once, so recovery takes the same time however the
+ * journal was left. A leaderboard in the old fixed table is copied into
+ * an empty journal.
  */ 
 
 
 #ifndef LEADERBOARD_H_
 #define LEADERBOARD_H_
 
+#include <stdint.h>
+#include "pt.h"
+
 void init_leaderboard(void);
 uint8_t made_leaderboard(uint16_t new_score);
 void print_leaderboard(uint8_t x, uint8_t y);
 
-void ask_name(uint16_t score);
+// Protothread which reads a name for the given score from the serial
+// input and adds it to the leaderboard. Finishes when enter is pressed.
+PT_THREAD(ask_name(struct pt* pt, uint16_t score));
 
 
 
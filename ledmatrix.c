@@ -9,6 +9,7 @@
 #include <avr/io.h>
 #include "ledmatrix.h"
 #include "spi.h"
+#include "settings.h"
 
 #define CMD_UPDATE_ALL 0x00
 #define CMD_UPDATE_PIXEL 0x01
@@ -18,10 +19,10 @@
 #define CMD_CLEAR_SCREEN 0x0F
 
 void ledmatrix_setup(void) {
-	// Setup SPI - we divide the clock by 128.
-	// (This speed guarantees the SPI buffer will never overflow on
-	// the LED matrix.)
-	spi_setup_master(128);
+	// Setup SPI - we divide the clock by 128 unless the settings say
+	// otherwise. (This speed guarantees the SPI buffer will never
+	// overflow on the LED matrix.)
+	spi_setup_master(SETTING(SET_SPI_DIVIDER));
 }
 
 void ledmatrix_update_all(MatrixData data) {
@@ -0,0 +1,104 @@
+/*
+ * profile.c
+ *
+ * Created: 19/10/2026 9:31:33 AM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "profile.h"
+#include "cycles.h"
+#include "terminalio.h"
+#include "sram.h"
+
+typedef struct {
+	uint32_t start;
+	uint32_t min;
+	uint32_t max;
+	uint32_t total;
+	uint16_t count;
+	uint16_t histogram[NUM_PROFILE_BUCKETS];
+} ProfileRegion;
+
+static ProfileRegion regions[NUM_PROFILE_REGIONS];
+
+SRAM_USAGE(profile, sizeof(regions));
+
+static const char name_asteroids[] PROGMEM = "advance_asteroids";
+static const char name_projectiles[] PROGMEM = "advance_projectiles";
+static const char name_draw_frame[] PROGMEM = "draw_frame";
+static const char name_print_terminal[] PROGMEM = "print_terminal_buffer";
+static PGM_P const region_names[NUM_PROFILE_REGIONS] PROGMEM = {
+	name_asteroids, name_projectiles, name_draw_frame,
+	name_print_terminal
+};
+
+void profile_start(uint8_t region) {
+	regions[region].start = get_cycles();
+}
+
+void profile_end(uint8_t region) {
+	uint32_t elapsed = get_cycles();
+	ProfileRegion* r = &regions[region];
+	elapsed -= r->start;
+	
+	if (r->count == 0 || elapsed < r->min) {
+		r->min = elapsed;
+	}
+	if (elapsed > r->max) {
+		r->max = elapsed;
+	}
+	
+	// Halve the count and total rather than let either overflow (this
+	// keeps the mean about right)
+	if (r->count == UINT16_MAX || r->total > UINT32_MAX - elapsed) {
+		r->count /= 2;
+		r->total /= 2;
+	}
+	r->count++;
+	r->total += elapsed;
+	
+	uint8_t bucket = 0;
+	elapsed >>= 8;
+	while (elapsed && bucket < NUM_PROFILE_BUCKETS-1) {
+		elapsed >>= 2;
+		bucket++;
+	}
+	if (r->histogram[bucket] < UINT16_MAX) {
+		r->histogram[bucket]++;
+	}
+}
+
+void reset_profile(void) {
+	for (uint8_t i = 0; i < NUM_PROFILE_REGIONS; i++) {
+		ProfileRegion* r = &regions[i];
+		r->min = 0;
+		r->max = 0;
+		r->total = 0;
+		r->count = 0;
+		for (uint8_t b = 0; b < NUM_PROFILE_BUCKETS; b++) {
+			r->histogram[b] = 0;
+		}
+	}
+}
+
+void print_profile(uint8_t x, uint8_t y) {
+	set_display_attribute(TERM_RESET);
+	move_cursor(x, y);
+	printf_P(PSTR("region (cycles)           n     min    mean     max "
+		" <256  <1k  <4k <16k <64k<256k  <1M  1M+"));
+	clear_to_end_of_line();
+	for (uint8_t i = 0; i < NUM_PROFILE_REGIONS; i++) {
+		ProfileRegion* r = &regions[i];
+		move_cursor(x, y+i+1);
+		printf_P(PSTR("%-21S %5u %7lu %7lu %7lu "),
+			(PGM_P)pgm_read_word(&region_names[i]), r->count, r->min,
+			r->count ? r->total / r->count : 0, r->max);
+		for (uint8_t b = 0; b < NUM_PROFILE_BUCKETS; b++) {
+			printf_P(PSTR(" %4u"), r->histogram[b]);
+		}
+		clear_to_end_of_line();
+	}
+}
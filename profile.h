@@ -0,0 +1,57 @@
+/*
+ * profile.h
+ *
+ * Created: 19/10/2026 9:31:40 AM
+ *  Author: Kenton
+ *
+ * Cycle level profiler for regions of code. Wrap a region in
+ * PROFILE_START(region) and PROFILE_END(region) and each pass through
+ * it is timed with the cycle counter (cycles.h). For each region we
+ * keep the minimum, mean and maximum cycle counts and a histogram.
+ * Regions can be nested (e.g. draw_frame() inside advance_asteroids())
+ * but a region must not be re-entered before it ends.
+ * Set PROFILING to 0 to compile the profiling out.
+ * Regions are also marked for the simulator benchmarks (simmark.h).
+ */
+
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include <stdint.h>
+#include "simmark.h"
+
+#define PROFILING 1
+
+// Profiled regions
+#define PROF_ADVANCE_ASTEROIDS		0
+#define PROF_ADVANCE_PROJECTILES	1
+#define PROF_DRAW_FRAME				2
+#define PROF_PRINT_TERMINAL			3
+#define NUM_PROFILE_REGIONS			4
+
+// Histogram buckets. Bucket 0 is under 256 cycles and each bucket after
+// that covers 4 times the cycles of the last (256-1k, 1k-4k ... 1M+).
+#define NUM_PROFILE_BUCKETS 8
+
+#if PROFILING
+#define PROFILE_START(region) \
+	do { profile_start(region); SIM_MARK(SIM_REGION_START | (region)); } while(0)
+#define PROFILE_END(region) \
+	do { SIM_MARK(SIM_REGION_END | (region)); profile_end(region); } while(0)
+#else
+#define PROFILE_START(region)	SIM_MARK(SIM_REGION_START | (region))
+#define PROFILE_END(region)		SIM_MARK(SIM_REGION_END | (region))
+#endif
+
+void profile_start(uint8_t region);
+void profile_end(uint8_t region);
+
+// Clear the statistics for all regions
+void reset_profile(void);
+
+// Print a table of statistics at the given terminal position (one line
+// per region plus a heading).
+void print_profile(uint8_t x, uint8_t y);
+
+#endif /* PROFILE_H_ */
@@ -22,52 +22,79 @@
 #include "game.h"
 #include "sound.h"
 #include "leaderboard.h"
-
-#define F_CPU 8000000L
-#include <util/delay.h>
+#include "keys.h"
+#include "scheduler.h"
+#include "display.h"
+#include "spi.h"
+#include "arena.h"
+#include "pt.h"
+#include "cpuload.h"
+#include "cycles.h"
+#include "profile.h"
+#include "isrstats.h"
+#include "iostats.h"
+#include "sram.h"
+#include "emit.h"
+#include "latency.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "settings.h"
+#include "console.h"
 
 #include <assert.h>
 
 // Function prototypes - these are defined below (after main()) in the order
 // given here
 void initialise_hardware(void);
-void splash_screen(void);
+PT_THREAD(run_app(struct pt* pt));
+PT_THREAD(splash_screen(struct pt* pt));
 void new_game(void);
 void play_game(void);
-void handle_game_over(void);
-
-// ASCII code for Escape character
-#define ESCAPE_CHAR 27
+void end_game(void);
+PT_THREAD(handle_game_over(struct pt* pt));
 
 uint8_t bgm_on = 0;
 
+// Protothreads for the application flow and the screen it is waiting on
+struct pt app_pt, screen_pt;
+
 /////////////////////////////// main //////////////////////////////////
 int main(void) {
 	// Setup hardware and call backs. This will turn on 
 	// interrupts.
 	initialise_hardware();
 	
-	// Show the splash screen message. Returns when display
-	// is complete
-	splash_screen();
-	start_bgm();
-	bgm_on = 1;
+	// Nothing in the main loop blocks - the application flow (splash
+	// screen, game, game over) is a protothread which returns whenever
+	// it is waiting, and the game itself runs as scheduled tasks.
+	PT_INIT(&app_pt);
 	while(1) {
-		new_game();
-		play_game();
-		handle_game_over();
+		(void)run_app(&app_pt);
+		run_tasks();
+		run_timer0_bottom_halves();
+		
+		// Everything the loop waits on (time passing, input) is signalled
+		// by an interrupt so sleep until the next one.
+		cpu_idle();
 	}
 }
 
 void initialise_hardware(void) {
+	// The settings are needed by everything below (the SPI clock and
+	// baud rate)
+	init_settings();
 	ledmatrix_setup();
 	set_display_attribute(TERM_RESET);
 	init_button_interrupts();
-	// Setup serial port for 19200 baud communication with no echo
-	// of incoming characters
-	init_serial_stdio(19200,0);
+	// Setup serial port (19200 baud by default) with no echo of
+	// incoming characters
+	init_serial_stdio((long)SETTING(SET_BAUD_X100)*100, 0);
+	init_keys();
 	
 	init_timer0();
+	init_cycle_counter();
+	LATENCY_INIT();
+	init_telemetry();
 	
 	init_leaderboard();
 	init_joystick();
@@ -77,7 +104,29 @@ void initialise_hardware(void) {
 	sei();
 }
 
-void splash_screen(void) {
+PT_THREAD(run_app(struct pt* pt)) {
+	PT_BEGIN(pt);
+	
+	// Show the splash screen message. Finishes when a button is
+	// pushed or a key pressed
+	arena_begin_phase(PHASE_SPLASH);
+	PT_SPAWN(pt, &screen_pt, splash_screen(&screen_pt));
+	start_bgm();
+	bgm_on = 1;
+	while(1) {
+		new_game();
+		play_game();
+		PT_WAIT_UNTIL(pt, is_game_over());
+		end_game();
+		PT_SPAWN(pt, &screen_pt, handle_game_over(&screen_pt));
+	}
+	
+	PT_END(pt);
+}
+
+PT_THREAD(splash_screen(struct pt* pt)) {
+	PT_BEGIN(pt);
+	
 	play_track(TRACK_WINDOWS);
 	// Clear terminal screen and output a message
 	clear_terminal();
@@ -88,6 +137,9 @@ void splash_screen(void) {
 	
 	print_leaderboard(10, 14);
 	
+	// Report the SRAM used by each module beside it
+	print_sram_report(X_STATS, 14);
+	
 	// Output the scrolling message to the LED matrix
 	// and wait for a push button to be pushed.
 	ledmatrix_clear();
@@ -97,16 +149,18 @@ void splash_screen(void) {
 		// Scroll the message until it has scrolled off the 
 		// display or a button is pushed
 		while(scroll_display()) {
-			_delay_ms(100);
+			PT_DELAY(pt, 100);
 			if(button_pushed() != NO_BUTTON_PUSHED || serial_input_available()) {
-				return;
+				PT_EXIT(pt);
 			}
 		}
 	}
+	
+	PT_END(pt);
 }
 
 void clear_all_input_buffers() {
-	clear_serial_input_buffer(); // empty serial buffer
+	clear_keys(); // empty serial buffer and partially decoded keys
 	while (button_pushed() != NO_BUTTON_PUSHED) {} // empty button butter
 }
 
@@ -114,6 +168,10 @@ void new_game(void) {
 	// Initialise the game and display
 	
 	
+	// The terminal frame buffer is borrowed from the arena for the game
+	arena_begin_phase(PHASE_GAME);
+	init_display_buffer();
+	
 	// Clear the serial terminal
 	clear_terminal();
 	hide_cursor();
@@ -150,183 +208,353 @@ void new_game(void) {
 	// Clear a button push or serial input if any are waiting
 	// (The cast to void means the return value is ignored.)
 	(void)button_pushed();
-	clear_serial_input_buffer();
+	clear_keys();
 }
 
 uint8_t prev_joystick = 100;
-uint32_t last_joystick_time = 0;
+uint16_t last_joystick_time = 0;
 uint16_t joystick_interval = 500;
 
 uint8_t check_joystick_move(uint8_t joystick) {
-	uint32_t cur_time = get_current_time();
+	uint16_t cur_time = get_fast_time();
 	
 	if (joystick != prev_joystick) { // react instantly at first but set long delay.
 		prev_joystick = joystick;
 		last_joystick_time = cur_time;
-		joystick_interval = 300;
+		joystick_interval = SETTING(SET_JOYSTICK_DELAY_MS);
 		return joystick;
 	}
 	
-	if (cur_time > last_joystick_time + joystick_interval) {
-		joystick_interval = 100;
+	if (TIME_SINCE(cur_time, last_joystick_time) > joystick_interval) {
+		joystick_interval = SETTING(SET_JOYSTICK_REPEAT_MS);
 		last_joystick_time = cur_time;
 		return joystick;
 	}
 	return 0;
 }
 
-void play_game(void) {
-	uint32_t current_time, last_proj_move, last_asteroid_move;
-	int8_t button, joy;
-	char serial_input, escape_sequence_char;
-	uint8_t characters_into_escape_sequence = 0;
+// Intervals (in milliseconds) for the tasks run while playing. The
+// projectile and asteroid intervals are settings (settings.h).
+#define INPUT_INTERVAL 2
+#define TERMINAL_FLUSH_INTERVAL 20
+#define PAUSE_BLINK_INTERVAL 500
+
+int8_t projectile_task, asteroid_task, input_task, flush_task, blink_task, io_stats_task;
+int8_t trace_task;
+uint8_t pause_label_shown;
+uint8_t console_paused_game;	// whether opening the console paused the game
+
+// Time between asteroid moves - gets shorter as the score increases.
+// (Switch D3 selects the faster schedule.)
+uint16_t asteroid_interval(void) {
+	int32_t asteroidTick;
+	if (SWITCH_D3()) {
+		asteroidTick = SETTING(SET_FAST_BASE_MS)
+			+ SETTING(SET_FAST_SCALE)/(get_score()+SETTING(SET_FAST_OFFSET));
+	} else {
+		asteroidTick = SETTING(SET_ASTEROID_BASE_MS)
+			+ SETTING(SET_ASTEROID_SCALE)/(get_score()+SETTING(SET_ASTEROID_OFFSET));
+		if (asteroidTick < SETTING(SET_ASTEROID_MIN_MS))
+			asteroidTick = SETTING(SET_ASTEROID_MIN_MS);
+	}
+	// The setting ranges keep this in range, but make sure
+	if (asteroidTick > MAX_TASK_INTERVAL) {
+		asteroidTick = MAX_TASK_INTERVAL;
+	}
+// 	if (get_score() > 1000 || asteroidTick < 180) {
+// 		asteroidTick = 180;
+// 	}
+	return asteroidTick;
+}
+
+void asteroid_tick(void) {
+	/*uint32_t c = get_current_time();*/
+	advance_asteroids();
+	/*printf("Render: %d     ", get_current_time() - c);*/
+	set_task_interval(asteroid_task, asteroid_interval());
+}
+
+void show_pause_label(uint8_t show) {
+	move_cursor(X_TITLE, Y_TITLE+1);
+	if (show) {
+		fast_set_display_attribute(BG_YELLOW);
+		fast_set_display_attribute(FG_BLACK);
+		printf_P(PSTR("(Paused)"));
+		fast_set_display_attribute(TERM_RESET);
+	} else {
+		clear_to_end_of_line();
+	}
+	pause_label_shown = show;
+}
+
+void blink_pause_label(void) {
+	show_pause_label(!pause_label_shown);
+}
+
+void toggle_pause(void) {
+	set_paused(is_paused() ^ 1);
+	if (is_paused()) {
+		pause_tasks();
+		show_pause_label(1);
+		start_task(blink_task);
+		pause_music();
+	} else {
+		stop_task(blink_task);
+		show_pause_label(0);
+		clear_all_input_buffers();
+		get_joystick_input();
+		try_unpause_music();
+		resume_tasks();
+	}
+}
+
+// Show (or toggle) the statistics for key, if it's a statistics key.
+// Returns 1 if it was.
+static uint8_t show_statistics(int16_t key) {
+	if (key == 'j' || key == 'J') {
+		// Show scheduler jitter statistics
+		print_task_stats(X_SCORE, Y_SCORE+3);
+		return 1;
+	}
+	if (key == 'u' || key == 'U') {
+		// Show CPU utilisation
+		print_cpu_load(X_SCORE, Y_SCORE+2);
+		return 1;
+	}
+	if (key == 'i' || key == 'I') {
+		// Show timer interrupt benchmark figures
+		print_timer0_stats(X_SCORE, Y_SCORE+2);
+		return 1;
+	}
+	if (key == 'f' || key == 'F') {
+		// Show the profile of the game and render functions, then
+		// start collecting afresh
+		print_profile(X_STATS, Y_STATS);
+		reset_profile();
+		return 1;
+	}
+	if (key == 'k' || key == 'K') {
+		// Show how much stack is free (now and at worst)
+		print_stack_free(X_SCORE, Y_SCORE+2);
+		return 1;
+	}
+#if EMIT_COMPARE
+	if (key == 'e' || key == 'E') {
+		// Compare the printf and emit.c versions of the output functions
+		emitcmp_print_comparison(X_STATS, Y_STATS);
+		return 1;
+	}
+#endif
+	if (key == 'b' || key == 'B') {
+		// Show/hide the SPI and UART bandwidth status line
+		toggle_io_status();
+		return 1;
+	}
+	if (key == 'v' || key == 'V') {
+		// Show the time spent in each interrupt vector and with
+		// interrupts disabled, then start collecting afresh
+		print_isr_stats(X_STATS, Y_STATS);
+		reset_isr_stats();
+		return 1;
+	}
+	if (key == 'o' || key == 'O') {
+		// Show how much terminal input has been received and lost
+		print_rx_stats(X_STATS, Y_STATS);
+		return 1;
+	}
+	if (key == 't') {
+		// Send the event trace (see trace.h)
+		trace_dump();
+		return 1;
+	}
+	if (key == 'T') {
+		// Start/stop streaming the event trace as it's recorded
+		toggle_trace_stream();
+		return 1;
+	}
+	return 0;
+}
+
+// Use the settings changed from the console
+static void apply_settings(void) {
+	set_task_interval(projectile_task, SETTING(SET_PROJECTILE_MS));
+	set_task_interval(asteroid_task, asteroid_interval());
+	ledmatrix_setup();
+}
+
+// Act on a single input - a button push, joystick move or key.
+void process_input(int8_t button, int8_t joy, int16_t key) {
+	if (is_game_over()) {
+		return;
+	}
+	
+	// While the console is open it gets every key (and nothing else
+	// happens, since the game is paused)
+	if (console_active()) {
+		if (key != KEY_NONE && console_key(key)) {
+			set_serial_pause_key(1);
+			apply_settings();
+			if (console_paused_game) {
+				toggle_pause();
+			}
+		}
+		return;
+	}
 	
-	int16_t asteroidTick = 0;
-	uint32_t pause_time = 0;
+	if (button != NO_BUTTON_PUSHED) {
+		TRACE(TRACE_INPUT, button, TRACE_INPUT_BUTTON);
+	} else if (joy) {
+		TRACE(TRACE_INPUT, joy, TRACE_INPUT_JOYSTICK);
+	} else {
+		TRACE(TRACE_INPUT, key, TRACE_INPUT_KEY);
+	}
 	
+	// Check for pause/unpause first.
+	if (key == 'p' || key == 'P') {
+		toggle_pause();
+		return;
+	}
+	if (key == KEY_ESCAPE) {
+		// Open the settings console (see console.h), pausing the game
+		// until it's closed
+		console_paused_game = !is_paused();
+		if (console_paused_game) {
+			toggle_pause();
+		}
+		// The console needs to see every 'p' typed
+		set_serial_pause_key(0);
+		console_open();
+		return;
+	}
 	
-	// Get the current time and remember this as the last time the projectiles
-    // were moved.
-	current_time = get_current_time();
-	last_proj_move = current_time;
-	last_asteroid_move = current_time;
+	// Statistics can be shown while paused. They go to the telemetry
+	// port if there is one.
+	if (key != KEY_NONE) {
+		telemetry_begin();
+		uint8_t shown = show_statistics(key);
+		telemetry_end();
+		if (shown) {
+			return;
+		}
+	}
 	
+	if (is_paused()) {
+		return;
+	}
+	if (key == 'M' || key == 'm') {
+		toggle_bgm();
+		bgm_on ^= 1;
+		return;
+	}
+	if (key == 'x') {
+		// Debug - move the asteroids now
+		run_task_now(asteroid_task);
+		return;
+	}
+	
+	// Toggle the latency pin on the first pixel this input lights (if any)
+	LATENCY_ARM();
+	if ((joy)==4 || button==3 || KEY_CODE(key)==KEY_LEFT || key=='L' || key=='l') {
+		// Button 3 pressed OR left cursor key escape sequence completed OR
+		// letter L (lowercase or uppercase) pressed - attempt to move left			
+		move_base(MOVE_LEFT);
+	} else if((joy)==1||button==2 || KEY_CODE(key)==KEY_UP || key==' ') {
+		// Button 2 pressed or up cursor key escape sequence completed OR
+		// space bar pressed - attempt to fire projectile
+		fire_projectile();
+	} else if(button==1 || KEY_CODE(key)==KEY_DOWN) {
+		// Button 1 pressed OR down cursor key escape sequence completed
+		// Ignore at present
+	} else if((joy)==2||button==0 || KEY_CODE(key)==KEY_RIGHT || key=='R' || key=='r') {
+		// Button 0 pressed OR right cursor key escape sequence completed OR
+		// letter R (lowercase or uppercase) pressed - attempt to move right
+		move_base(MOVE_RIGHT);
+	} else {};
+	// else - invalid input - do nothing
+	LATENCY_DISARM();
+}
+
+// Act on pause keys picked out by the serial receive interrupt. As well
+// as from drain_input(), this is the scheduler's hook (set_task_hook())
+// so that a pause typed while the loop was held up (e.g. waiting for
+// room in the serial output buffer) stops the game tasks still due,
+// rather than waiting for the next input poll.
+static void handle_pause_presses(void) {
+	for (uint8_t n = serial_pause_presses(); n; n--) {
+		process_input(NO_BUTTON_PUSHED, 0, 'p');
+	}
+}
+
+// Check for input - which could be a button push, joystick move or
+// serial input - and process all of it. Serial input is decoded into key
+// events (escape sequences such as ESC [ D for the left cursor key
+// become KEY_LEFT etc.). Button pushes are dealt with before keys.
+void drain_input(void) {
+	int8_t button, joy;
+	int16_t key;
+	
+	// Pause keys are picked out by the serial receive interrupt, so
+	// they're dealt with before anything else that's waiting
+	handle_pause_presses();
+	
+	joy = check_joystick_move(get_joystick_input());
+	if (joy && !is_paused()) {
+		process_input(NO_BUTTON_PUSHED, joy, KEY_NONE);
+	}
+	while ((button = button_pushed()) != NO_BUTTON_PUSHED) {
+		process_input(button, 0, KEY_NONE);
+	}
+	poll_keys();
+	while ((key = key_pressed()) != KEY_NONE) {
+		process_input(NO_BUTTON_PUSHED, 0, key);
+	}
+	if (console_active()) {
+		console_poll();
+	}
+}
+
+void play_game(void) {
 	get_joystick_input();
 	if (bgm_on)
 		start_bgm();
 	
+	// Each part of the game runs as a task with its own interval. The
+	// input task keeps running while paused so we can unpause.
+	init_tasks();
+	set_task_hook(handle_pause_presses);
+	input_task = add_task(drain_input, INPUT_INTERVAL, TASK_PERIODIC|TASK_WHILE_PAUSED);
+	projectile_task = add_task(advance_projectiles, SETTING(SET_PROJECTILE_MS), TASK_PERIODIC);
+	asteroid_task = add_task(asteroid_tick, asteroid_interval(), TASK_PERIODIC);
+	flush_task = add_task(print_terminal_buffer, TERMINAL_FLUSH_INTERVAL, TASK_PERIODIC);
+	blink_task = add_task(blink_pause_label, PAUSE_BLINK_INTERVAL, TASK_PERIODIC|TASK_WHILE_PAUSED);
+	stop_task(blink_task);
+	pause_label_shown = 0;
+	io_stats_task = add_task(update_io_stats, IO_STATS_INTERVAL, TASK_PERIODIC|TASK_WHILE_PAUSED);
+	reset_io_stats();
+	trace_task = add_task(trace_stream, TRACE_STREAM_INTERVAL, TASK_PERIODIC|TASK_WHILE_PAUSED);
 	
-	// We play the game until it's over
-	while(!is_game_over()) {
-		
-		// Check for input - which could be a button push or serial input.
-		// Serial input may be part of an escape sequence, e.g. ESC [ D
-		// is a left cursor key press. At most one of the following three
-		// variables will be set to a value other than -1 if input is available.
-		// (We don't initalise button to -1 since button_pushed() will return -1
-		// if no button pushes are waiting to be returned.)
-		// Button pushes take priority over serial input. If there are both then
-		// we'll retrieve the serial input the next time through this loop
-		serial_input = -1;
-		escape_sequence_char = -1;
-		button = button_pushed();
-		joy = check_joystick_move(get_joystick_input());
+	// Have the serial receive interrupt pick out the pause key
+	set_serial_pause_key(1);
+	
+	// The tasks are run from the main loop until the game is over
+}
 
-		
-		if(button == NO_BUTTON_PUSHED) {
-			// No push button was pushed, see if there is any serial input
-			if(serial_input_available()) {
-				// Serial data was available - read the data from standard input
-				serial_input = fgetc(stdin);
-				// Check if the character is part of an escape sequence
-				if(characters_into_escape_sequence == 0 && serial_input == ESCAPE_CHAR) {
-					// We've hit the first character in an escape sequence (escape)
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 1 && serial_input == '[') {
-					// We've hit the second character in an escape sequence
-					characters_into_escape_sequence++;
-					serial_input = -1; // Don't further process this character
-				} else if(characters_into_escape_sequence == 2) {
-					// Third (and last) character in the escape sequence
-					escape_sequence_char = serial_input;
-					serial_input = -1;  // Don't further process this character - we
-										// deal with it as part of the escape sequence
-					characters_into_escape_sequence = 0;
-				} else {
-					// Character was not part of an escape sequence (or we received
-					// an invalid second character in the sequence). We'll process 
-					// the data in the serial_input variable.
-					characters_into_escape_sequence = 0;
-				}
-			}
-		}
-		
-		// Process the input. 
-		// Check for pause/unpause first.
-		if (serial_input == 'p' || serial_input == 'P') {
-			// Unimplemented feature - pause/unpause the game until 'p' or 'P' is
-			// pressed again
-			set_paused(is_paused() ^ 1);			
-			move_cursor(2, 3);
-			if (is_paused()) {
-				pause_time = get_current_time();
-				move_cursor(X_TITLE, Y_TITLE+1);
-				fast_set_display_attribute(BG_YELLOW);
-				fast_set_display_attribute(FG_BLACK);
-				printf_P(PSTR("(Paused)"));
-				fast_set_display_attribute(TERM_RESET);
-				pause_music();
-			} else {
-				current_time = get_current_time();
-				last_asteroid_move += current_time-pause_time;
-				last_proj_move += current_time-pause_time;
-				move_cursor(X_TITLE, Y_TITLE+1);
-				clear_to_end_of_line();
-				clear_all_input_buffers();
-				get_joystick_input();
-				try_unpause_music();
-			}
-		}
-		if (is_paused()) {
-			continue;
-		}
-		if (serial_input == 'M' || serial_input == 'm') {
-			toggle_bgm();
-			bgm_on ^= 1;
-			continue;
-		}
-		
-		if ((joy)==4 || button==3 || escape_sequence_char=='D' || serial_input=='L' || serial_input=='l') {
-			// Button 3 pressed OR left cursor key escape sequence completed OR
-			// letter L (lowercase or uppercase) pressed - attempt to move left			
-			move_base(MOVE_LEFT);
-		} else if((joy)==1||button==2 || escape_sequence_char=='A' || serial_input==' ') {
-			// Button 2 pressed or up cursor key escape sequence completed OR
-			// space bar pressed - attempt to fire projectile
-			fire_projectile();
-		} else if(button==1 || escape_sequence_char=='B') {
-			// Button 1 pressed OR down cursor key escape sequence completed
-			// Ignore at present
-		} else if((joy)==2||button==0 || escape_sequence_char=='C' || serial_input=='R' || serial_input=='r') {
-			// Button 0 pressed OR right cursor key escape sequence completed OR
-			// letter R (lowercase or uppercase) pressed - attempt to move right
-			move_base(MOVE_RIGHT);
-		} else {};
-		// else - invalid input or we're part way through an escape sequence -
-		// do nothing
-		
-		current_time = get_current_time();
-		if(!is_paused() && current_time >= last_proj_move + 100) {
-			// 500ms (0.5 second) has passed since the last time we moved
-			// the projectiles - move them - and keep track of the time we 
-			// moved them
-			advance_projectiles();
-			last_proj_move = current_time;
-		}
-		
-		if (PIND & (1<<PIND3)) {
-			asteroidTick = 120 + 3000/(get_score()+4);
-		} else {
-			asteroidTick = 150 + 30000/(get_score()+20);
-			if (asteroidTick < 550)
-				asteroidTick = 550;
-		}		
-// 		if (get_score() > 1000 || asteroidTick < 180) {
-// 			asteroidTick = 180;
-// 		}
-		if(serial_input=='x' || (!is_paused() && current_time >= last_asteroid_move + asteroidTick) ) {
-			/*uint32_t c = get_current_time();*/
-			advance_asteroids();
-			/*printf("Render: %d     ", get_current_time() - c);*/
-			last_asteroid_move = current_time;
-		}
-		
-	}
-	// We get here if the game is over.
+void end_game(void) {
+	// Stop all of the game's tasks and send anything left in the
+	// terminal buffer before it goes back to the arena
+	init_tasks();
+	print_terminal_buffer();
+	// 'p' is an ordinary key again (for the name entry)
+	set_serial_pause_key(0);
 }
 
-void handle_game_over() {
+PT_THREAD(handle_game_over(struct pt* pt)) {
+	// Protothread for entering a name on the leaderboard
+	static struct pt name_pt;
+	
+	PT_BEGIN(pt);
+	
+	arena_begin_phase(PHASE_GAME_OVER);
 	stop_bgm();
 	play_track(TRACK_SHUTDOWN);
 	for (uint8_t y = 0; y < H_GAME_OVER+2; y++) {
@@ -340,7 +568,7 @@ void handle_game_over() {
 	move_cursor(X_GAME_OVER+1, Y_GAME_OVER+1);
 	printf_P(PSTR("GAME OVER"));
 	
-	_delay_ms(300);
+	PT_DELAY(pt, 300);
 	
 	move_cursor(X_GAME_OVER+1, Y_GAME_OVER+2);
 	printf_P(PSTR("Score: %d. "), get_score());
@@ -351,15 +579,14 @@ void handle_game_over() {
 		move_cursor(X_GAME_OVER+1, Y_GAME_OVER+3);
 		printf_P(PSTR("Name: "));
 
-		ask_name(get_score());
+		PT_SPAWN(pt, &name_pt, ask_name(&name_pt, get_score()));
 		print_leaderboard(X_LEADERBOARD, Y_TOP);
 	}
-	_delay_ms(200);
+	PT_DELAY(pt, 200);
 	move_cursor(X_GAME_OVER+1,Y_GAME_OVER+4);
 	printf_P(PSTR("Press any key to start over..."));
 	clear_all_input_buffers();
-	while(button_pushed() == NO_BUTTON_PUSHED && !serial_input_available()) {
-		; // wait
-	}
+	PT_WAIT_UNTIL(pt, button_pushed() != NO_BUTTON_PUSHED || serial_input_available());
 	
+	PT_END(pt);
 }
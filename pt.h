@@ -0,0 +1,95 @@
+/*
+ * pt.h
+ *
+ * Created: 18/10/2026 3:22:50 PM
+ *  Author: Kenton
+ *
+ * Protothreads - stackless coroutines in the style of Adam Dunkels'
+ * protothreads library. A protothread is a function which is called
+ * repeatedly from the main loop; where it would otherwise block it
+ * returns instead and resumes from the same place on the next call.
+ * The resume point is kept in a struct pt using a switch statement
+ * with a case label at each blocking point, so:
+ *  - local variables are NOT preserved across a blocking macro (use
+ *    static variables for anything that must survive a wait)
+ *  - a protothread must not use a switch statement of its own around
+ *    a blocking macro
+ *  - only one blocking macro may appear on each source line
+ */
+
+
+#ifndef PT_H_
+#define PT_H_
+
+#include <stdint.h>
+#include "timer0.h"
+
+struct pt {
+	uint16_t lc;		// line number to resume from (0 = start)
+	uint16_t timer;		// start time for PT_DELAY() (from get_fast_time())
+};
+
+// Return values of a protothread
+#define PT_WAITING	0
+#define PT_YIELDED	1
+#define PT_EXITED	2
+#define PT_ENDED	3
+
+// Declare a protothread, e.g. PT_THREAD(splash_screen(struct pt* pt));
+#define PT_THREAD(name_args) char name_args
+
+// Initialise a protothread so that it runs from the start when next called
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; \
+	switch((pt)->lc) { case 0:
+
+#define PT_END(pt) } PT_INIT(pt); return PT_ENDED; }
+
+// Block until the condition is true. The condition is re-evaluated each
+// time the protothread is called.
+#define PT_WAIT_UNTIL(pt, condition) \
+	do { \
+		(pt)->lc = __LINE__; case __LINE__: \
+		if(!(condition)) { \
+			return PT_WAITING; \
+		} \
+	} while(0)
+
+#define PT_WAIT_WHILE(pt, condition) PT_WAIT_UNTIL((pt), !(condition))
+
+// Return to the caller once, continuing from here on the next call
+#define PT_YIELD(pt) \
+	do { \
+		PT_YIELD_FLAG = 0; \
+		(pt)->lc = __LINE__; case __LINE__: \
+		if(PT_YIELD_FLAG == 0) { \
+			return PT_YIELDED; \
+		} \
+	} while(0)
+
+// Leave the protothread (it will restart from the beginning next time)
+#define PT_EXIT(pt) \
+	do { \
+		PT_INIT(pt); \
+		return PT_EXITED; \
+	} while(0)
+
+// Returns non-zero while the protothread call is still running
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+
+// Start a child protothread and block until it has finished
+#define PT_SPAWN(pt, child, thread) \
+	do { \
+		PT_INIT((child)); \
+		PT_WAIT_WHILE((pt), PT_SCHEDULE(thread)); \
+	} while(0)
+
+// Block for the given number of milliseconds (up to ~32 seconds)
+#define PT_DELAY(pt, ms) \
+	do { \
+		(pt)->timer = get_fast_time(); \
+		PT_WAIT_UNTIL((pt), TIME_SINCE(get_fast_time(), (pt)->timer) >= (ms)); \
+	} while(0)
+
+#endif /* PT_H_ */
@@ -0,0 +1,217 @@
+/*
+ * scheduler.c
+ *
+ * Created: 18/10/2026 1:04:09 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/pgmspace.h>
+
+#include "scheduler.h"
+#include "terminalio.h"
+#include "timer0.h"
+#include "sram.h"
+
+// Deadlines are 16 bit times from get_fast_time(), compared with the
+// wrap-safe TIME_REACHED(). While tasks are paused, the deadline of each
+// paused task holds the time it had left instead, since its real
+// deadline could end up more than the ~32 seconds TIME_REACHED() can
+// cope with in the past.
+typedef struct {
+	TaskFunction function;
+	uint16_t deadline;
+	uint16_t interval;
+	uint8_t flags;
+	uint16_t runs;
+	uint16_t max_lateness;
+} Task;
+
+static Task tasks[MAX_TASKS];
+static uint8_t numTasks;
+
+// Earliest deadline of any task which can currently run (only valid
+// if have_deadline is set).
+static uint16_t next_deadline;
+static uint8_t have_deadline;
+
+static uint8_t tasks_paused;
+
+// Called before each task which doesn't run while paused
+static TaskFunction task_hook;
+
+SRAM_USAGE(scheduler, sizeof(tasks) + sizeof(numTasks) + sizeof(next_deadline)
+	+ sizeof(have_deadline) + sizeof(tasks_paused) + sizeof(task_hook));
+
+static uint8_t can_run(Task* t) {
+	return (t->flags & TASK_ACTIVE)
+		&& (!tasks_paused || (t->flags & TASK_WHILE_PAUSED));
+}
+
+// Work out the earliest deadline. Only called when a deadline changes,
+// not on every pass of the main loop.
+static void update_next_deadline(void) {
+	uint16_t now = get_fast_time();
+	uint16_t soonest = UINT16_MAX;
+	have_deadline = 0;
+	for (uint8_t i = 0; i < numTasks; i++) {
+		if (!can_run(&tasks[i])) {
+			continue;
+		}
+		// Time until the deadline (0 if it has already passed)
+		uint16_t until = TIME_REACHED(now, tasks[i].deadline)
+			? 0 : TIME_SINCE(tasks[i].deadline, now);
+		if (!have_deadline || until < soonest) {
+			soonest = until;
+			next_deadline = tasks[i].deadline;
+			have_deadline = 1;
+		}
+	}
+}
+
+void init_tasks(void) {
+	numTasks = 0;
+	tasks_paused = 0;
+	have_deadline = 0;
+	task_hook = NULL;
+}
+
+void set_task_hook(TaskFunction hook) {
+	task_hook = hook;
+}
+
+int8_t add_task(TaskFunction function, uint16_t interval, uint8_t flags) {
+	if (numTasks >= MAX_TASKS || interval > MAX_TASK_INTERVAL) {
+		return -1;
+	}
+	Task* t = &tasks[numTasks];
+	t->function = function;
+	t->interval = interval;
+	t->flags = flags;
+	t->runs = 0;
+	t->max_lateness = 0;
+	start_task(numTasks);
+	return numTasks++;
+}
+
+int8_t set_task_interval(int8_t task, uint16_t interval) {
+	if (interval > MAX_TASK_INTERVAL) {
+		return 1;
+	}
+	tasks[task].interval = interval;
+	return 0;
+}
+
+void start_task(int8_t task) {
+	tasks[task].deadline = get_fast_time() + tasks[task].interval;
+	tasks[task].flags |= TASK_ACTIVE;
+	update_next_deadline();
+}
+
+void run_task_now(int8_t task) {
+	tasks[task].deadline = get_fast_time();
+	tasks[task].flags |= TASK_ACTIVE;
+	update_next_deadline();
+}
+
+void stop_task(int8_t task) {
+	tasks[task].flags &= ~TASK_ACTIVE;
+	update_next_deadline();
+}
+
+void pause_tasks(void) {
+	if (tasks_paused) {
+		return;
+	}
+	uint16_t now = get_fast_time();
+	for (uint8_t i = 0; i < numTasks; i++) {
+		if (!(tasks[i].flags & TASK_WHILE_PAUSED)) {
+			// Remember the time left (none if overdue)
+			tasks[i].deadline = TIME_REACHED(now, tasks[i].deadline)
+				? 0 : TIME_SINCE(tasks[i].deadline, now);
+		}
+	}
+	tasks_paused = 1;
+	update_next_deadline();
+}
+
+void resume_tasks(void) {
+	if (!tasks_paused) {
+		return;
+	}
+	uint16_t now = get_fast_time();
+	for (uint8_t i = 0; i < numTasks; i++) {
+		if (!(tasks[i].flags & TASK_WHILE_PAUSED)) {
+			// Deadline currently holds the time left
+			tasks[i].deadline += now;
+		}
+	}
+	tasks_paused = 0;
+	update_next_deadline();
+}
+
+void run_tasks(void) {
+	uint16_t now = get_fast_time();
+	if (!have_deadline || !TIME_REACHED(now, next_deadline)) {
+		return; // nothing due
+	}
+
+	for (uint8_t i = 0; i < numTasks; i++) {
+		Task* t = &tasks[i];
+		if (!can_run(t) || !TIME_REACHED(now, t->deadline)) {
+			continue;
+		}
+		if (task_hook && !(t->flags & TASK_WHILE_PAUSED)) {
+			task_hook();
+			// The hook may have paused the tasks, or paused and resumed
+			// them (pushing the deadline back to after now)
+			now = get_fast_time();
+			if (!can_run(t) || !TIME_REACHED(now, t->deadline)) {
+				continue;
+			}
+		}
+
+		uint16_t late = TIME_SINCE(now, t->deadline);
+		if (late > t->max_lateness) {
+			t->max_lateness = late;
+		}
+		t->runs++;
+
+		if (t->flags & TASK_PERIODIC) {
+			// Keep to the original schedule unless we've fallen a whole
+			// interval behind, in which case we skip the missed runs.
+			// (The interval is read after running so the task can change
+			// its own interval.)
+			t->function();
+			t->deadline += t->interval;
+			if (TIME_REACHED(now, t->deadline)) {
+				t->deadline = now + t->interval;
+			}
+		} else {
+			t->flags &= ~TASK_ACTIVE;
+			t->function();
+		}
+	}
+	update_next_deadline();
+}
+
+uint8_t tasks_due(void) {
+	return have_deadline && TIME_REACHED(get_fast_time(), next_deadline);
+}
+
+uint16_t task_runs(int8_t task) {
+	return tasks[task].runs;
+}
+
+uint16_t task_max_lateness(int8_t task) {
+	return tasks[task].max_lateness;
+}
+
+void print_task_stats(uint8_t x, uint8_t y) {
+	for (uint8_t i = 0; i < numTasks; i++) {
+		move_cursor(x, y+i);
+		printf_P(PSTR("Task %d: %5u runs, max late %3ums"), i,
+			tasks[i].runs, tasks[i].max_lateness);
+		clear_to_end_of_line();
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * scheduler.h
+ *
+ * Created: 18/10/2026 1:04:17 PM
+ *  Author: Kenton
+ *
+ * A small cooperative scheduler. Tasks are functions which are run
+ * from the main loop (by run_tasks()) when their deadline has passed.
+ * Periodic tasks are rescheduled relative to their previous deadline so
+ * they don't drift; one-shot tasks are deactivated after running.
+ * The earliest deadline is worked out when tasks are (re)scheduled so
+ * that a call to run_tasks() with nothing due is just a time read and
+ * one comparison. Deadlines are 16 bit, so intervals must be less than
+ * ~32 seconds.
+ */
+
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#define MAX_TASKS 8
+
+// Longest interval a task can have. A deadline any further ahead looks
+// overdue to TIME_REACHED() (timer0.h).
+#define MAX_TASK_INTERVAL INT16_MAX
+
+// Task flags
+#define TASK_PERIODIC		(1<<0)	// reschedule after running (otherwise one-shot)
+#define TASK_WHILE_PAUSED	(1<<1)	// keep running while tasks are paused
+#define TASK_ACTIVE			(1<<2)	// (internal) task is scheduled to run
+
+typedef void (*TaskFunction)(void);
+
+// Remove all tasks (and the hook below).
+void init_tasks(void);
+
+// Set a function for run_tasks() to call before each task without
+// TASK_WHILE_PAUSED, or NULL for none. If the hook pauses the tasks, the
+// task is skipped. This lets something flagged by an interrupt (e.g. a
+// pause key) stop the tasks still due in this pass, rather than waiting
+// for its own task to come round.
+void set_task_hook(TaskFunction hook);
+
+// Add a task which will first run interval milliseconds from now and
+// (if flags includes TASK_PERIODIC) every interval milliseconds after
+// that. Returns the task number, or -1 if the task table is full or
+// interval is more than MAX_TASK_INTERVAL.
+int8_t add_task(TaskFunction function, uint16_t interval, uint8_t flags);
+
+// Change the interval of a periodic task. Takes effect from its next run.
+// Returns 0 if it was changed, or 1 (leaving the interval as it was) if
+// interval is more than MAX_TASK_INTERVAL.
+int8_t set_task_interval(int8_t task, uint16_t interval);
+
+// (Re)start a task so that it runs interval milliseconds from now.
+void start_task(int8_t task);
+
+// Schedule a task to run on the next call to run_tasks(). Periodic tasks
+// continue on their interval from then.
+void run_task_now(int8_t task);
+
+// Stop a task from running until start_task() is called.
+void stop_task(int8_t task);
+
+// Pause/resume all tasks without the TASK_WHILE_PAUSED flag. On resume
+// their deadlines are pushed back by the time spent paused. (Tasks
+// without TASK_WHILE_PAUSED shouldn't be started while paused.)
+void pause_tasks(void);
+void resume_tasks(void);
+
+// Run every task whose deadline has passed. Called from the main loop.
+void run_tasks(void);
+
+// Whether any task is due to run. Safe to call with interrupts off.
+uint8_t tasks_due(void);
+
+// Jitter statistics - the number of times a task has run and the
+// largest number of milliseconds by which it has missed its deadline.
+uint16_t task_runs(int8_t task);
+uint16_t task_max_lateness(int8_t task);
+
+// Print the statistics above for every task at the given terminal position.
+void print_task_stats(uint8_t x, uint8_t y);
+
+#endif /* SCHEDULER_H_ */
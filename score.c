@@ -6,6 +6,7 @@
 
 #include "score.h"
 #include "terminalio.h"
+#include "emit.h"
 #include <avr/io.h>
 #include <stdio.h>
 #include <avr/pgmspace.h>
@@ -14,9 +15,15 @@
 #define FLASH_PERIOD 100 
 #define FLASH_ON 50
 
+// Columns the score takes up on the terminal (more if it needs them)
+#define SCORE_WIDTH 4
+
 uint8_t seven_seg[10] = { 63,6,91,79,102,109,125,7,127,111};
 
 int32_t score = -1;
+// The score again as packed BCD (a decimal digit per nibble, units in
+// the bottom one) so the displays don't have to divide to get digits
+uint32_t score_bcd;
 uint8_t left = 0;
 int32_t lives = -1;
 uint8_t tick = 0;
@@ -24,6 +31,22 @@ uint8_t tick = 0;
 uint8_t score_x;
 uint8_t score_y;
 
+// Seven segment patterns for the right (0) and left (1) digits. These are
+// worked out by update_score_segments() in the main loop so that the
+// interrupt handler only has to write them out.
+static volatile uint8_t segments[2];
+static volatile uint8_t segments_valid = 0;
+static volatile uint8_t flashing = 0;
+
+// Whether segments[] needs working out again (the score has changed)
+static uint8_t segments_stale = 0;
+
+// The score as last printed on the terminal and the columns it took, so
+// only the digits which change need to be sent (0 columns means it
+// needs printing in full)
+static uint32_t printed_bcd;
+static uint8_t printed_width;
+
 static void print_score();
 static void print_lives();
 
@@ -40,17 +63,58 @@ void init_score(uint8_t x, uint8_t y) {
 	
 	
 	score = 0;
+	score_bcd = 0;
+	segments_stale = 1;
+	printed_width = 0;
 	lives = MAX_LIVES;
 	print_score();
 	print_lives();
 }
 
+static uint32_t to_bcd(uint32_t n) {
+	uint32_t bcd = 0;
+	for (uint8_t shift = 0; n && shift < 32; shift += 4) {
+		bcd |= (uint32_t)(n % 10) << shift;
+		n /= 10;
+	}
+	return bcd;
+}
+
+// Add two packed BCD numbers, a digit at a time. Stops as soon as
+// there's nothing left to carry, so adding 1 usually only looks at the
+// units.
+static uint32_t bcd_add(uint32_t a, uint32_t b) {
+	uint32_t result = 0;
+	uint8_t carry = 0;
+	for (uint8_t shift = 0; shift < 32; shift += 4) {
+		if (!b && !carry) {
+			return result | (a << shift);
+		}
+		uint8_t digit = (a & 0x0F) + (b & 0x0F) + carry;
+		carry = (digit > 9);
+		if (carry) {
+			digit -= 10;
+		}
+		result |= (uint32_t)digit << shift;
+		a >>= 4;
+		b >>= 4;
+	}
+	return result;
+}
+
 void add_to_score(int16_t value) {
 	if (score+value < 0) {
 		score = 0;
+		score_bcd = 0;
 	} else {
 		score += value;
+		if (value >= 0) {
+			score_bcd = bcd_add(score_bcd, value < 10 ? value : to_bcd(value));
+		} else {
+			score_bcd = to_bcd(score);
+		}
 	}
+	segments_stale = 1;
 	print_score();
 }
 
@@ -58,37 +122,109 @@ int32_t get_score(void) {
 	return score;
 }
 
+// Digit n (0 is the units) of a BCD number
+static uint8_t bcd_digit(uint32_t bcd, uint8_t n) {
+	return (bcd >> 4*n) & 0x0F;
+}
+
+// Index of the highest non-zero digit (0 if the number is 0)
+static uint8_t bcd_top(uint32_t bcd) {
+	uint8_t top = 0;
+	while (top < 7 && (bcd >> 4*(top+1))) {
+		top++;
+	}
+	return top;
+}
+
+// Character for digit n of a right aligned BCD number - a space for
+// leading zeros
+static char bcd_char(uint32_t bcd, uint8_t n) {
+	if (n > 0 && (bcd >> 4*n) == 0) {
+		return ' ';
+	}
+	return '0' + bcd_digit(bcd, n);
+}
+
 void print_score(void) {
-	set_display_attribute(TERM_RESET);
-	move_cursor(score_x, score_y);
-	printf("Score:%4lu", score);
+	uint8_t width = bcd_top(score_bcd) + 1;
+	if (width < SCORE_WIDTH) {
+		width = SCORE_WIDTH;
+	}
+	uint8_t full = (width != printed_width);
+	uint8_t started = 0;	// attributes reset
+	uint8_t in_place = 0;	// cursor is where the next digit goes
+	
+	if (full) {
+		set_display_attribute(TERM_RESET);
+		move_cursor(score_x, score_y);
+		emit_P(PSTR("Score:"));
+		started = 1;
+		in_place = 1;
+	}
+	// Only send the digits which have changed (usually just the units)
+	for (int8_t n = width-1; n >= 0; n--) {
+		char c = bcd_char(score_bcd, n);
+		if (!full && c == bcd_char(printed_bcd, n)) {
+			in_place = 0;
+			continue;
+		}
+		if (!started) {
+			set_display_attribute(TERM_RESET);
+			started = 1;
+		}
+		if (!in_place) {
+			move_cursor(score_x + 6 + width-1-n, score_y);
+			in_place = 1;
+		}
+		emit_char(c);
+	}
+	if (full) {
+		// Rub out the end of a longer score
+		for (uint8_t n = width; n < printed_width; n++) {
+			emit_char(' ');
+		}
+	}
+	printed_bcd = score_bcd;
+	printed_width = width;
 	s_invalidate_mode();
 }
 
-void update_score_tick(void) {
-	if (score != -1) {
-		uint8_t digit = 0;
-		uint8_t dp = 0;
-		uint16_t shifted_score = score;
-		while (shifted_score >= 100) {
-			shifted_score /= 10;
-		}
-		if (left) {
-			digit = (shifted_score/10)%10;
-			dp = score >= 1000;
-		} else {
-			digit = shifted_score % 10;
-			dp = score >= 100;
-		}	
+void update_score_segments(void) {
+	flashing = (lives == 0);
+	if (!segments_stale) {
+		return;
+	}
+	segments_stale = 0;
+	
+	// Show the two leading digits, with the decimal points marking how
+	// many more there are (as the right one for 100+, both for 1000+)
+	uint8_t top = bcd_top(score_bcd);
+	if (top < 1) {
+		top = 1;
+	}
+	
+	// Left digit - blank if it would be a leading zero
+	uint8_t digit = bcd_digit(score_bcd, top);
+	segments[1] = digit == 0 ? 0 : seven_seg[digit] | ((top >= 3) << 7);
+	
+	// Right digit
+	digit = bcd_digit(score_bcd, top-1);
+	segments[0] = seven_seg[digit] | ((top >= 2) << 7);
+	
+	segments_valid = 1;
+}
+
+void display_score_digit(void) {
+	if (segments_valid) {
 		PORTD = (PORTD&~(1<<PORTD2)) | (left << PORTD2);
-		if ( (lives == 0 && tick >= FLASH_ON) || (left && digit == 0) ) {
+		if (flashing && tick >= FLASH_ON) {
 			PORTC = 0;
-			} else {
-			PORTC = seven_seg[digit] | (dp << 7);
+		} else {
+			PORTC = segments[left];
 		}
 	}
 	
-	if (lives == 0) {
+	if (flashing) {
 		PORTA = (PORTA & 0x0f) | (tick >= FLASH_ON ? 0 : 0xf0);
 	}
 	
@@ -13,7 +13,14 @@ void init_score(uint8_t x, uint8_t y);
 void add_to_score(int16_t value);
 int32_t get_score(void);
 
-void update_score_tick(void);
+// Work out the seven segment display patterns for the current score,
+// if it has changed. Run from the main loop (see
+// run_timer0_bottom_halves()).
+void update_score_segments(void);
+
+// Show the next digit of the seven segment display. Called from the
+// timer interrupt handler so must be quick.
+void display_score_digit(void);
 
 void change_lives(int8_t change);
 int32_t get_lives(void);
@@ -26,6 +26,12 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
+#include "serialio.h"
+#include "isrstats.h"
+#include "iostats.h"
+#include "cycles.h"
+#include "sram.h"
+
 /* System clock rate in Hz. (L at the end indicates this is a long constant) */
 #define SYSCLK 8000000L
 
@@ -49,17 +55,33 @@ volatile uint8_t bytes_in_out_buffer;
 /* Circular buffer to hold incoming characters. Works on same principle
  * as output buffer
  */
-#define INPUT_BUFFER_SIZE 16
+#define INPUT_BUFFER_SIZE 64
 volatile char input_buffer[INPUT_BUFFER_SIZE];
 volatile uint8_t input_insert_pos;
 volatile uint8_t bytes_in_input_buffer;
-volatile uint8_t input_overrun;
+
+/* Whether the receive interrupt picks out the pause key (see
+ * set_serial_pause_key()), where it is in any escape sequence, and the
+ * number of pause keys it has seen which haven't been taken yet
+ */
+#define RX_GROUND	0	/* not in an escape sequence */
+#define RX_ESC		1	/* seen ESC */
+#define RX_SEQUENCE	2	/* seen ESC [ or ESC O */
+static uint8_t pause_key_enabled;
+static uint8_t rx_state;
+static volatile uint8_t pause_presses;
 
 /* Variable to keep track of whether incoming characters are to be echoed
  * back or not.
  */
 static int8_t do_echo;
 
+/* The baud rate we're running at, and whether anything has been sent
+ * at it (see set_serial_baud())
+ */
+static long current_baud;
+static uint8_t sent_since_baud_change;
+
 /* Function prototypes 
  */
 void init_serial_stdio(long baudrate, int8_t echo);
@@ -72,8 +94,88 @@ static int uart_get_char(FILE*);
 static FILE myStream = FDEV_SETUP_STREAM(uart_put_char, uart_get_char,
 		_FDEV_SETUP_RW);
 
+SRAM_USAGE(serialio, sizeof(out_buffer) + sizeof(out_insert_pos)
+		+ sizeof(bytes_in_out_buffer) + sizeof(input_buffer)
+		+ sizeof(input_insert_pos) + sizeof(bytes_in_input_buffer)
+		+ sizeof(pause_key_enabled) + sizeof(rx_state)
+		+ sizeof(pause_presses) + sizeof(do_echo) + sizeof(myStream)
+		+ sizeof(current_baud) + sizeof(sent_since_baud_change));
+
+/* UBRR value for baudrate, in double speed (U2X) mode or not.
+ * (This differs from the datasheet formula so that we get rounding to
+ * the nearest integer while using integer division (which truncates)).
+ * Returns -1 if the rate is too fast or too slow for the clock.
+ */
+static int16_t baud_divider(long baudrate, uint8_t u2x) {
+	long ubrr = ((SYSCLK / ((u2x ? 4 : 8) * baudrate)) + 1)/2 - 1;
+	if(ubrr < 0 || ubrr > 4095) {
+		return -1;
+	}
+	return ubrr;
+}
+
+/* Error (in tenths of a percent, either way) of the rate we would get
+ * for baudrate in the given mode.
+ */
+static uint16_t divider_error(long baudrate, uint8_t u2x) {
+	int16_t ubrr = baud_divider(baudrate, u2x);
+	if(ubrr < 0) {
+		return UINT16_MAX;
+	}
+	long actual = SYSCLK / ((u2x ? 8L : 16L) * (ubrr + 1));
+	long error = (actual - baudrate) * 1000 / baudrate;
+	return error < 0 ? -error : error;
+}
+
+/* Whether double speed mode gets closer to baudrate. Normal mode is
+ * preferred if they're as good as each other since the receiver samples
+ * each bit more often.
+ */
+static uint8_t use_u2x(long baudrate) {
+	return divider_error(baudrate, 1) < divider_error(baudrate, 0);
+}
+
+uint16_t serial_baud_error(long baudrate) {
+	if(baudrate <= 0) {
+		return UINT16_MAX;
+	}
+	return divider_error(baudrate, use_u2x(baudrate));
+}
+
+static void set_baud(long baudrate) {
+	uint8_t u2x = use_u2x(baudrate);
+	UBRR0 = baud_divider(baudrate, u2x);
+	if(u2x) {
+		UCSR0A |= (1<<U2X0);
+	} else {
+		UCSR0A &= ~(1<<U2X0);
+	}
+	current_baud = baudrate;
+	sent_since_baud_change = 0;
+}
+
+long serial_baud(void) {
+	return current_baud;
+}
+
+int8_t set_serial_baud(long baudrate) {
+	if(serial_baud_error(baudrate) > SERIAL_MAX_BAUD_ERROR) {
+		return 1;
+	}
+	/* Let everything already queued go out at the old rate (the
+	 * transmit complete flag is cleared whenever a byte is sent, so
+	 * once it's set again the last stop bit has gone). This needs
+	 * interrupts on, like any other output.
+	*/
+	while(bytes_in_out_buffer > 0
+			|| (sent_since_baud_change && !(UCSR0A & (1<<TXC0)))) {
+		/* do nothing */
+	}
+	set_baud(baudrate);
+	return 0;
+}
+
 void init_serial_stdio(long baudrate, int8_t echo) {
-	uint16_t ubrr;
 	/*
 	 * Initialise our buffers
 	*/
@@ -81,20 +183,22 @@ void init_serial_stdio(long baudrate, int8_t echo) {
 	bytes_in_out_buffer = 0;
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
-	input_overrun = 0;
+	pause_key_enabled = 0;
+	rx_state = RX_GROUND;
+	pause_presses = 0;
 	
 	/*
 	 * Record whether we're going to echo characters or not
 	*/
 	do_echo = echo;
 	
-	/* Configure the serial port baud rate */
-	/* (This differs from the datasheet formula so that we get 
-	 * rounding to the nearest integer while using integer division
-	 * (which truncates)).
+	/* Configure the serial port baud rate, falling back to the default
+	 * if the clock can't get close enough to the one asked for.
 	*/
-	ubrr = ((SYSCLK / (8 * baudrate)) + 1)/2 - 1;
-	UBRR0 = ubrr;
+	if(serial_baud_error(baudrate) > SERIAL_MAX_BAUD_ERROR) {
+		baudrate = SERIAL_DEFAULT_BAUD;
+	}
+	set_baud(baudrate);
 	
 	/*
 	 * Enable transmission and receiving via UART. We don't enable
@@ -124,13 +228,87 @@ int8_t serial_input_available(void) {
 
 void clear_serial_input_buffer(void) {
 	/* Just adjust our buffer data so it looks empty */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
 	input_insert_pos = 0;
 	bytes_in_input_buffer = 0;
+	pause_presses = 0;
+	rx_state = RX_GROUND;
+	if(interrupts_enabled) {
+		sei();
+	}
+}
+
+uint8_t serial_read_bytes(uint8_t* dest, uint8_t max) {
+	/* Copy out as many bytes as we can in one go, oldest first. As in
+	 * uart_get_char() the oldest byte is bytes_in_input_buffer before
+	 * the insert position.
+	 */
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	CLI_STATS_ENTER();
+	uint8_t n = bytes_in_input_buffer < max ? bytes_in_input_buffer : max;
+	int8_t pos = input_insert_pos - bytes_in_input_buffer;
+	if(pos < 0) {
+		pos += INPUT_BUFFER_SIZE;
+	}
+	for(uint8_t i = 0; i < n; i++) {
+		dest[i] = input_buffer[pos++];
+		if(pos == INPUT_BUFFER_SIZE) {
+			pos = 0;
+		}
+	}
+	bytes_in_input_buffer -= n;
+	CLI_STATS_EXIT(CLI_UART_GET_CHAR);
+	if(interrupts_enabled) {
+		sei();
+	}
+	return n;
+}
+
+void set_serial_pause_key(uint8_t enable) {
+	pause_key_enabled = enable;
+}
+
+uint8_t serial_pause_presses(void) {
+	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
+	cli();
+	uint8_t n = pause_presses;
+	pause_presses = 0;
+	if(interrupts_enabled) {
+		sei();
+	}
+	return n;
+}
+
+/* Whether a received character is the pause key on its own (not part
+ * of an escape sequence such as ESC O P, or ESC p for alt-P). This only
+ * needs to follow sequences well enough to know where they end - keys.c
+ * does the real decoding.
+ */
+static uint8_t is_pause_key(char c) {
+	switch(rx_state) {
+		case RX_ESC:
+			rx_state = (c == '[' || c == 'O') ? RX_SEQUENCE
+				: (c == 27) ? RX_ESC : RX_GROUND;
+			return 0;
+		case RX_SEQUENCE:
+			if(c == 27) {
+				rx_state = RX_ESC;
+			} else if(c >= 0x40 && c <= 0x7e) {
+				rx_state = RX_GROUND;
+			}
+			return 0;
+		default:
+			if(c == 27) {
+				rx_state = RX_ESC;
+				return 0;
+			}
+			return (c == 'p' || c == 'P');
+	}
 }
 
 static int uart_put_char(char c, FILE* stream) {
-	uint8_t interrupts_enabled;
-	
 	/* Add the character to the buffer for transmission (if there 
 	 * is space to do so). If not we wait until the buffer has space.
 	 * If the character is \n, we output \r (carriage return)
@@ -139,6 +317,15 @@ static int uart_put_char(char c, FILE* stream) {
 	if(c == '\n') {
 		uart_put_char('\r', stream);
 	}
+	return serial_put_byte(c);
+}
+
+uint8_t serial_output_backlog(void) {
+	return bytes_in_out_buffer;
+}
+
+int8_t serial_put_byte(char c) {
+	uint8_t interrupts_enabled;
 	
 	/* If the buffer is full and interrupts are disabled then we
 	 * abort - we don't output the character since the buffer will
@@ -148,11 +335,18 @@ static int uart_put_char(char c, FILE* stream) {
 	 * ISR which extracts bytes from the buffer.
 	*/
 	interrupts_enabled = bit_is_set(SREG, SREG_I);
-	while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+	if(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
 		if(!interrupts_enabled) {
+			uart_stats.dropped++;
 			return 1;
-		}		
-		/* else do nothing */
+		}
+		/* Keep track of how long we spend waiting (see iostats.h) */
+		uint32_t wait_start = get_cycles();
+		while(bytes_in_out_buffer >= OUTPUT_BUFFER_SIZE) {
+			/* do nothing */
+		}
+		uart_stats.blocked += get_cycles() - wait_start;
+		uart_stats.blocks++;
 	}
 	
 	/* Add the character to the buffer for transmission if there
@@ -165,8 +359,11 @@ static int uart_put_char(char c, FILE* stream) {
 	 * function.
 	*/	
 	cli();
+	CLI_STATS_ENTER();
 	out_buffer[out_insert_pos++] = c;
 	bytes_in_out_buffer++;
+	sent_since_baud_change = 1;
+	uart_stats.bytes++;
 	if(out_insert_pos == OUTPUT_BUFFER_SIZE) {
 		/* Wrap around buffer pointer if necessary */
 		out_insert_pos = 0;
@@ -175,6 +372,7 @@ static int uart_put_char(char c, FILE* stream) {
 	 * disabled) - we ensure it is now enabled so that it will
 	 * fire and deal with the next character in the buffer. */
 	UCSR0B |= (1 << UDRIE0);
+	CLI_STATS_EXIT(CLI_UART_PUT_CHAR);
 	if(interrupts_enabled) {
 		sei();
 	}
@@ -196,6 +394,7 @@ int uart_get_char(FILE* stream) {
 	 */
 	uint8_t interrupts_enabled = bit_is_set(SREG, SREG_I);
 	cli();
+	CLI_STATS_ENTER();
 	char c;
 	if(input_insert_pos - bytes_in_input_buffer < 0) {
 		/* Need to wrap around */
@@ -207,6 +406,7 @@ int uart_get_char(FILE* stream) {
 	
 	/* Decrement our count of bytes in the input buffer */
 	bytes_in_input_buffer--;
+	CLI_STATS_EXIT(CLI_UART_GET_CHAR);
 	if(interrupts_enabled) {
 		sei();
 	}	
@@ -219,6 +419,8 @@ int uart_get_char(FILE* stream) {
  */
 ISR(USART0_UDRE_vect) 
 {
+	ISR_STATS_ENTER();
+	
 	/* Check if we have data in our buffer */
 	if(bytes_in_out_buffer > 0) {
 		/* Yes we do - remove the pending byte and output it
@@ -240,7 +442,10 @@ ISR(USART0_UDRE_vect)
 		 */
 		bytes_in_out_buffer--;
 		
-		/* Output the character via the UART */
+		/* Output the character via the UART (clearing the transmit
+		 * complete flag - see set_serial_baud())
+		 */
+		UCSR0A |= (1<<TXC0);
 		UDR0 = c;
 	} else {
 		/* No data in the buffer. We disable the UART Data
@@ -251,6 +456,8 @@ ISR(USART0_UDRE_vect)
 		 */
 		UCSR0B &= ~(1<<UDRIE0);
 	}
+	
+	ISR_STATS_EXIT(ISR_USART0_UDRE);
 }
 
 /*
@@ -261,9 +468,36 @@ ISR(USART0_UDRE_vect)
 
 ISR(USART0_RX_vect) 
 {
-	/* Read the character - we ignore the possibility of overrun. */
+	ISR_STATS_ENTER();
+	
+	/* Read the character, counting any lost because we didn't get
+	 * here in time (data overrun). Characters with a framing error are
+	 * dropped - they're usually the other end talking at a different
+	 * baud rate.
+	 */
 	char c;
+	uint8_t status = UCSR0A;
 	c = UDR0;
+	rx_stats.bytes++;
+	if(status & (1<<DOR0)) {
+		rx_stats.uart_overruns++;
+	}
+	if(status & (1<<FE0)) {
+		rx_stats.framing_errors++;
+		ISR_STATS_EXIT(ISR_USART0_RX);
+		return;
+	}
+	
+	/* The pause key is counted here rather than queued, so it takes
+	 * effect ahead of anything else waiting and even if the buffer is
+	 * full.
+	 */
+	if(pause_key_enabled && is_pause_key(c)) {
+		pause_presses++;
+		rx_stats.pause_keys++;
+		ISR_STATS_EXIT(ISR_USART0_RX);
+		return;
+	}
 		
 	if(do_echo && bytes_in_out_buffer < OUTPUT_BUFFER_SIZE) {
 		/* If echoing is enabled and there is output buffer
@@ -275,13 +509,11 @@ ISR(USART0_RX_vect)
 	}
 	
 	/* 
-	 * Check if we have space in our buffer. If not, set the overrun
-	 * flag and throw away the character. (We never clear the 
-	 * overrun flag - it's up to the programmer to check/clear
-	 * this flag if desired.)
+	 * Check if we have space in our buffer. If not, count the
+	 * overrun and throw away the character.
 	 */
 	if(bytes_in_input_buffer >= INPUT_BUFFER_SIZE) {
-		input_overrun = 1;
+		rx_stats.ring_overruns++;
 	} else {
 		/* If the character is a carriage return, turn it into a
 		 * linefeed 
@@ -300,6 +532,8 @@ ISR(USART0_RX_vect)
 			input_insert_pos = 0;
 		}
 	}
+	
+	ISR_STATS_EXIT(ISR_USART0_RX);
 }
 
 void set_echo(uint8_t new_echo) {
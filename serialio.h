@@ -18,13 +18,42 @@
 
 #include <stdint.h>
 
+/* Baud rate used if the one asked for can't be produced accurately
+ * enough from the 8MHz clock
+ */
+#define SERIAL_DEFAULT_BAUD 19200L
+
+/* Largest baud rate error we accept, in tenths of a percent. Each end
+ * can be out by about this much before bytes get corrupted. With double
+ * speed (U2X) mode 38400 and 76800 baud are within 0.2% and 57600 is
+ * 2.1% out; 115200 (3.5%) is refused.
+ */
+#define SERIAL_MAX_BAUD_ERROR 25
+
 /* Initialise serial IO using the UART. baudrate specifies the desired
  * baud rate (e.g. 19200) and echo determines whether incoming characters
  * are echoed back to the UART output as they are received (zero means no
- * echo, non-zero means echo)
+ * echo, non-zero means echo). Double speed mode is used if it gets
+ * closer to the baud rate. If the rate is more than
+ * SERIAL_MAX_BAUD_ERROR out, SERIAL_DEFAULT_BAUD is used instead.
  */
 void init_serial_stdio(long baudrate, int8_t echo);
 
+/* Return the error (in tenths of a percent, either way) of the closest
+ * rate we can get to baudrate.
+ */
+uint16_t serial_baud_error(long baudrate);
+
+/* Switch to a new baud rate once the output buffer has been sent.
+ * Returns 1 (and does nothing) if the rate is more than
+ * SERIAL_MAX_BAUD_ERROR out, or 0 if it was changed.
+ */
+int8_t set_serial_baud(long baudrate);
+
+/* Return the current baud rate
+ */
+long serial_baud(void);
+
 /* Test if input is available from the serial port. Return 0 if not,
  * non-zero otherwise. If there is input available then it can be read
  * with a suitable standard IO library function, e.g. fgetc().
@@ -32,10 +61,39 @@ void init_serial_stdio(long baudrate, int8_t echo);
 int8_t serial_input_available(void);
 
 /* Discard any input waiting to be read from the serial port. (Characters may
- * have been typed when we didn't want them - clear them.
+ * have been typed when we didn't want them - clear them.) Uncounted
+ * pause keys are discarded too.
  */
 void clear_serial_input_buffer(void);
 
+/* Copy up to max bytes of waiting input into dest without going through
+ * stdio. Returns the number of bytes copied (0 if there were none).
+ */
+uint8_t serial_read_bytes(uint8_t* dest, uint8_t max);
+
+/* Turn on or off picking out the pause key ('p' or 'P' outside an
+ * escape sequence) in the receive interrupt. While on, pause keys are
+ * counted instead of being put in the input buffer, so a pause can't
+ * be stuck behind a burst of other input or lost if the buffer fills.
+ * It should only be on while nothing else wants to read a 'p'.
+ */
+void set_serial_pause_key(uint8_t enable);
+
+/* Return (and clear) the number of pause keys received
+ */
+uint8_t serial_pause_presses(void);
+
 void set_echo(uint8_t new_echo);
 
+/* Add a byte to the output buffer without going through stdio (no \n
+ * to \r\n translation). Blocks while the buffer is full if interrupts
+ * are enabled; otherwise the byte is discarded and 1 is returned.
+ * Returns 0 on success. See emit.h for formatted output on top of this.
+ */
+int8_t serial_put_byte(char c);
+
+/* Return the number of bytes waiting in the output buffer.
+ */
+uint8_t serial_output_backlog(void);
+
 #endif /* SERIALIO_H_ */
\ No newline at end of file
@@ -0,0 +1,201 @@
+/*
+ * settings.c
+ *
+ * Created: 20/10/2026 8:02:24 PM
+ *  Author: Kenton
+ */
+
+#include <string.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include "settings.h"
+#include "serialio.h"
+#include "eequeue.h"
+#include "scheduler.h"
+#include "sram.h"
+
+// Settings which must be a power of two (the SPI divider)
+#define POWER_OF_TWO 1
+// Settings which must be a baud rate we can do accurately (/100)
+#define BAUD_RATE 2
+
+typedef struct {
+	PGM_P name;
+	uint16_t min;
+	uint16_t max;
+	uint16_t initial;
+	uint8_t flags;
+} SettingInfo;
+
+static const char name_projectile[] PROGMEM = "projectile_ms";
+static const char name_asteroid_base[] PROGMEM = "asteroid_base_ms";
+static const char name_asteroid_scale[] PROGMEM = "asteroid_scale";
+static const char name_asteroid_offset[] PROGMEM = "asteroid_offset";
+static const char name_asteroid_min[] PROGMEM = "asteroid_min_ms";
+static const char name_fast_base[] PROGMEM = "fast_base_ms";
+static const char name_fast_scale[] PROGMEM = "fast_scale";
+static const char name_fast_offset[] PROGMEM = "fast_offset";
+static const char name_joystick_delay[] PROGMEM = "joy_delay_ms";
+static const char name_joystick_repeat[] PROGMEM = "joy_repeat_ms";
+static const char name_dead_radius[] PROGMEM = "dead_radius";
+static const char name_spi_divider[] PROGMEM = "spi_divider";
+static const char name_baud[] PROGMEM = "baud_x100";
+
+// The asteroid interval can't be longer than the scheduler allows
+typedef char asteroid_interval_fits[
+	(MAX_ASTEROID_BASE_MS + MAX_ASTEROID_SCALE <= MAX_TASK_INTERVAL) ? 1 : -1];
+
+// The defaults are the values these had as constants
+static const SettingInfo info[NUM_SETTINGS] PROGMEM = {
+	{ name_projectile,		20,	1000,	100,	0 },
+	{ name_asteroid_base,	0,	MAX_ASTEROID_BASE_MS,	150,	0 },
+	{ name_asteroid_scale,	0,	MAX_ASTEROID_SCALE,	30000,	0 },
+	{ name_asteroid_offset,	1,	1000,	20,		0 },
+	{ name_asteroid_min,	50,	5000,	550,	0 },
+	{ name_fast_base,		0,	MAX_ASTEROID_BASE_MS,	120,	0 },
+	{ name_fast_scale,		0,	MAX_ASTEROID_SCALE,	3000,	0 },
+	{ name_fast_offset,		1,	1000,	4,		0 },
+	{ name_joystick_delay,	10,	2000,	300,	0 },
+	{ name_joystick_repeat,	10,	2000,	100,	0 },
+	{ name_dead_radius,		10,	500,	200,	0 },
+	{ name_spi_divider,		2,	128,	128,	POWER_OF_TWO },
+	{ name_baud,			12,	2500,	192,	BAUD_RATE },
+};
+
+// Layout of the EEPROM block (see settings.h)
+#define EE_MAGIC	((uint16_t*)SETTINGS_EEPROM_ADDRESS)
+#define EE_VERSION	((uint8_t*)SETTINGS_EEPROM_ADDRESS + 2)
+#define EE_COUNT	((uint8_t*)SETTINGS_EEPROM_ADDRESS + 3)
+#define EE_VALUES	((uint16_t*)(SETTINGS_EEPROM_ADDRESS + 4))
+#define EE_CRC(count)	((uint8_t*)SETTINGS_EEPROM_ADDRESS + 4 + 2*(count))
+
+uint16_t settings[NUM_SETTINGS];
+static uint8_t changed;
+
+SRAM_USAGE(settings, sizeof(settings) + sizeof(changed));
+
+const char* setting_name(uint8_t n) {
+	return (const char*)pgm_read_word(&info[n].name);
+}
+
+uint16_t setting_min(uint8_t n) {
+	return pgm_read_word(&info[n].min);
+}
+
+uint16_t setting_max(uint8_t n) {
+	return pgm_read_word(&info[n].max);
+}
+
+uint16_t setting_default(uint8_t n) {
+	return pgm_read_word(&info[n].initial);
+}
+
+static uint8_t allowed(uint8_t n, uint16_t value) {
+	if (value < setting_min(n) || value > setting_max(n)) {
+		return 0;
+	}
+	uint8_t flags = pgm_read_byte(&info[n].flags);
+	if ((flags & POWER_OF_TWO) && (value & (value-1))) {
+		return 0;
+	}
+	if ((flags & BAUD_RATE) && serial_baud_error(value*100L) > SERIAL_MAX_BAUD_ERROR) {
+		return 0;
+	}
+	return 1;
+}
+
+int8_t set_setting(uint8_t n, uint16_t value) {
+	if (n >= NUM_SETTINGS || !allowed(n, value)) {
+		return 1;
+	}
+	// Some settings are read by interrupt handlers (the dead radius)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		settings[n] = value;
+	}
+	changed = 1;
+	return 0;
+}
+
+void default_settings(void) {
+	for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+		set_setting(i, setting_default(i));
+	}
+}
+
+uint8_t settings_changed(void) {
+	return changed;
+}
+
+// CRC of the EEPROM block up to (not including) the CRC byte
+static uint8_t block_crc(uint8_t count) {
+	uint8_t crc = 0;
+	const uint8_t* end = EE_CRC(count);
+	for (const uint8_t* p = (const uint8_t*)SETTINGS_EEPROM_ADDRESS; p < end; p++) {
+		crc = _crc8_ccitt_update(crc, eeprom_read_byte(p));
+	}
+	return crc;
+}
+
+// Read what we can from the EEPROM block over the current settings.
+// Returns 0 if the block is valid.
+static int8_t read_block(void) {
+	// The EEPROM can't be read while a queued write is going on
+	flush_eeprom_writes();
+	if (eeprom_read_word(EE_MAGIC) != SETTINGS_MAGIC
+			|| eeprom_read_byte(EE_VERSION) != SETTINGS_VERSION) {
+		return 1;
+	}
+	uint8_t count = eeprom_read_byte(EE_COUNT);
+	if (EE_CRC(count) > (uint8_t*)E2END
+			|| eeprom_read_byte(EE_CRC(count)) != block_crc(count)) {
+		return 1;
+	}
+	// Settings added since the block was written keep their defaults,
+	// as do any values we wouldn't allow
+	for (uint8_t i = 0; i < count && i < NUM_SETTINGS; i++) {
+		set_setting(i, eeprom_read_word(EE_VALUES + i));
+	}
+	return 0;
+}
+
+int8_t load_settings(void) {
+	default_settings();
+	int8_t result = read_block();
+	changed = 0;
+	return result;
+}
+
+void init_settings(void) {
+	// Any button held down means use the defaults (buttons are
+	// active high on PB0-3)
+	if (PINB & 0x0F) {
+		default_settings();
+		changed = 0;
+	} else {
+		load_settings();
+	}
+}
+
+void save_settings(void) {
+	flush_eeprom_writes();
+	// eeprom_update_*() only writes bytes which have changed
+	eeprom_update_word(EE_MAGIC, SETTINGS_MAGIC);
+	eeprom_update_byte(EE_VERSION, SETTINGS_VERSION);
+	eeprom_update_byte(EE_COUNT, NUM_SETTINGS);
+	eeprom_update_block(settings, EE_VALUES, sizeof(settings));
+	eeprom_update_byte(EE_CRC(NUM_SETTINGS), block_crc(NUM_SETTINGS));
+	changed = 0;
+}
+
+int8_t find_setting(const char* name) {
+	for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+		if (strcmp_P(name, setting_name(i)) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
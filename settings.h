@@ -0,0 +1,96 @@
+/*
+ * settings.h
+ *
+ * Created: 20/10/2026 8:02:16 PM
+ *  Author: Kenton
+ *
+ * Tuning parameters which used to be compile time constants - task
+ * intervals, the asteroid speed-up formula, joystick repeat, the SPI
+ * clock and the baud rate. They can be changed at run time from the
+ * console (console.h) and saved to EEPROM, so a board can be tuned
+ * without reflashing it.
+ *
+ * The EEPROM copy is a block at SETTINGS_EEPROM_ADDRESS, well clear of
+ * the leaderboard:
+ *   uint16_t magic		SETTINGS_MAGIC
+ *   uint8_t version	SETTINGS_VERSION
+ *   uint8_t count		number of values that follow
+ *   uint16_t values[count]
+ *   uint8_t crc		CRC-8 (CCITT) of everything before it
+ * New settings are added to the end of the list, so an older block
+ * still loads (the new settings get their defaults). The version only
+ * changes if the meaning of an existing setting changes, and a block
+ * with any other version is ignored.
+ *
+ * Holding any button down while the board resets uses the defaults,
+ * in case a bad setting (e.g. the baud rate) makes the console
+ * unreachable.
+ */
+
+
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include <stdint.h>
+
+#define SETTINGS_EEPROM_ADDRESS	0x380	// up to 0x3FF (the end of EEPROM)
+#define SETTINGS_MAGIC			0x5453	// "ST"
+#define SETTINGS_VERSION		1
+
+// Settings, in EEPROM order (only ever add to the end)
+#define SET_PROJECTILE_MS		0	// projectile task interval
+#define SET_ASTEROID_BASE_MS	1	// asteroid interval is base + scale/(score + offset)...
+#define SET_ASTEROID_SCALE		2
+#define SET_ASTEROID_OFFSET		3
+#define SET_ASTEROID_MIN_MS		4	// ... but no less than this
+#define SET_FAST_BASE_MS		5	// the same with switch D3 on (no minimum)
+#define SET_FAST_SCALE			6
+#define SET_FAST_OFFSET			7
+#define SET_JOYSTICK_DELAY_MS	8	// joystick auto-repeat delay
+#define SET_JOYSTICK_REPEAT_MS	9	// ... and interval
+#define SET_DEAD_RADIUS			10	// joystick dead zone (ADC counts)
+#define SET_SPI_DIVIDER			11	// LED matrix SPI clock divider
+#define SET_BAUD_X100			12	// terminal baud rate / 100 at reset
+#define NUM_SETTINGS			13
+
+// Largest base and scale for the asteroid interval. With the smallest
+// offset (1) the interval at score 0 is base + scale, which has to fit
+// in a task interval (MAX_TASK_INTERVAL in scheduler.h).
+#define MAX_ASTEROID_BASE_MS	2000
+#define MAX_ASTEROID_SCALE		30000
+
+extern uint16_t settings[NUM_SETTINGS];
+
+#define SETTING(n)	(settings[n])
+
+// Load the settings at reset - as load_settings(), but using the
+// defaults if a button is being held down.
+void init_settings(void);
+
+// Load the settings from EEPROM. Returns 0 if they were loaded, or 1 if
+// there isn't a valid saved block and the defaults are being used.
+int8_t load_settings(void);
+
+// Set a setting, if value is allowed. Returns 0 if it was set, or 1 if
+// the value is out of range.
+int8_t set_setting(uint8_t n, uint16_t value);
+
+// Put every setting back to its default (without saving)
+void default_settings(void);
+
+// Write the settings to EEPROM
+void save_settings(void);
+
+// Whether any setting has been changed since they were loaded or saved
+uint8_t settings_changed(void);
+
+// Look up a setting by name. Returns -1 if there's no such setting.
+int8_t find_setting(const char* name);
+
+// Name (in program memory), range and default of a setting
+const char* setting_name(uint8_t n);
+uint16_t setting_min(uint8_t n);
+uint16_t setting_max(uint8_t n);
+uint16_t setting_default(uint8_t n);
+
+#endif /* SETTINGS_H_ */
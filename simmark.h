@@ -0,0 +1,30 @@
+/*
+ * simmark.h
+ *
+ * Created: 20/10/2026 9:12:05 AM
+ *  Author: Kenton
+ *
+ * Markers for the simulator benchmarks (tools/simbench). When built
+ * with SIMBENCH defined, SIM_MARK() writes a code to the otherwise
+ * unused GPIOR0 register - one instruction - and the simulator, which
+ * watches that register, notes the cycle it happened on. Otherwise the
+ * markers compile to nothing.
+ */
+
+
+#ifndef SIMMARK_H_
+#define SIMMARK_H_
+
+#include <avr/io.h>
+
+// Marker codes. The low 6 bits hold a profile region (profile.h).
+#define SIM_REGION_START	0x80
+#define SIM_REGION_END		0xC0
+
+#ifdef SIMBENCH
+#define SIM_MARK(code)		(GPIOR0 = (code))
+#else
+#define SIM_MARK(code)
+#endif
+
+#endif /* SIMMARK_H_ */
@@ -6,6 +6,8 @@
  */ 
 #include "sound.h"
 #include "timer0.h"
+#include "isrstats.h"
+#include "sram.h"
 
 #include <avr/io.h>
 #include <stdio.h>
@@ -46,6 +48,10 @@ volatile uint8_t semiquavers = 0;
 volatile uint8_t playing = 0;
 volatile uint8_t playingBGM = 0;
 
+SRAM_USAGE(sound, sizeof(musicIndexes) + sizeof(musicOffsets)
+	+ sizeof(musicLengths) + sizeof(curTrack) + sizeof(semiquavers)
+	+ sizeof(playing) + sizeof(playingBGM));
+
 void start_bgm() {
 	playingBGM = 1;
 	play_track(TRACK_TOUHOU);
@@ -181,9 +187,11 @@ void tick_sound() {
 }
 
 ISR(PCINT3_vect) {
+	ISR_STATS_ENTER();
 	if (PIND & (1<<PIND5)) {
 		unpause_music();
 	} else {
 		pause_music();
 	}
+	ISR_STATS_EXIT(ISR_PCINT3);
 }
\ No newline at end of file
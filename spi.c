@@ -6,15 +6,8 @@
 
 #include <avr/io.h>
 #include "spi.h"
-
-uint8_t buffer[255];
-uint8_t bufferIndex = 0;
-uint8_t buffering = 0;
-
-void start_spi_buffer() {
-	bufferIndex = 0;
-	buffering = 1;	
-}
+#include "iostats.h"
+#include "cycles.h"
 
 void spi_setup_master(uint8_t clockdivider) {
 	// Set up SPI communication as a master
@@ -63,35 +56,21 @@ void spi_setup_master(uint8_t clockdivider) {
 	PORTB &= ~(1<<4);
 }
 
-uint8_t real_spi_send_byte(uint8_t byte) {
+uint8_t spi_send_byte(uint8_t byte) {
 	// Write out the byte to the SPDR0 register. This will initiate
 	// the transfer. We then wait until the most significant byte of
 	// SPSR0 (SPIF0 bit) is set - this indicates that the transfer is
 	// complete. (The final read of SPSR0 followed by a read of SPDR0
 	// will cause the SPIF bit to be reset to 0. See page 173 of the
 	// ATmega324A datasheet.)
+	// The wait is timed with the timer 2 count - one byte takes at most
+	// 8*128 cycles, well short of the 2048 cycles before it wraps.
+	uint8_t start = TCNT2;
 	SPDR0 = byte;
 	while((SPSR0 & (1<<SPIF0)) == 0) {
 		; // wait
 	}
+	spi_stats.bytes++;
+	spi_stats.blocked += (uint8_t)(TCNT2 - start) * CYCLES_PER_COUNT;
 	return SPDR0;
 }
-
-uint8_t spi_send_byte(uint8_t byte) {
-	if (!buffering) {
-		return real_spi_send_byte(byte);
-	} else {
-		buffer[bufferIndex] = byte;
-		bufferIndex++;
-		return 0;
-	}
-}
-
-void flush_spi_buffer() {
-	for (uint8_t i = 0; i < bufferIndex; i++) {
-		real_spi_send_byte(buffer[i]);
-		buffer[i] = 0;
-	}
-	buffering = 0;
-	bufferIndex = 0;
-}
\ No newline at end of file
@@ -0,0 +1,149 @@
+/*
+ * sram.c
+ *
+ * Created: 19/10/2026 3:08:33 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "sram.h"
+#include "terminalio.h"
+#include "telemetry.h"
+
+// Symbols defined by the linker script
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t _end;		// end of the static variables (start of the heap)
+extern uint8_t __stack;		// top of SRAM (RAMEND)
+
+// Paint from the end of the statics up to the top of the stack. This is
+// in the .init1 section so it runs straight after reset, before the
+// stack pointer and r1 are set up (in .init2) and before .data and .bss
+// are initialised, so it has to be assembly which uses no stack.
+void paint_stack(void) __attribute__((naked, used, section(".init1")));
+
+void paint_stack(void) {
+	__asm volatile (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		: : "i" (STACK_PAINT)
+	);
+}
+
+// Modules which report their usage with SRAM_USAGE()
+extern const uint16_t display_sram_bytes;
+extern const uint16_t serialio_sram_bytes;
+extern const uint16_t leaderboard_sram_bytes;
+extern const uint16_t game_sram_bytes;
+extern const uint16_t sound_sram_bytes;
+extern const uint16_t scheduler_sram_bytes;
+extern const uint16_t profile_sram_bytes;
+extern const uint16_t keys_sram_bytes;
+extern const uint16_t arena_sram_bytes;
+extern const uint16_t trace_sram_bytes;
+extern const uint16_t settings_sram_bytes;
+extern const uint16_t console_sram_bytes;
+extern const uint16_t eequeue_sram_bytes;
+#if TELEMETRY
+extern const uint16_t telemetry_sram_bytes;
+#endif
+
+typedef struct {
+	PGM_P name;
+	const uint16_t* bytes;
+} ModuleUsage;
+
+static const char name_display[] PROGMEM = "display";
+static const char name_serialio[] PROGMEM = "serialio";
+static const char name_leaderboard[] PROGMEM = "leaderboard";
+static const char name_game[] PROGMEM = "game";
+static const char name_sound[] PROGMEM = "sound";
+static const char name_scheduler[] PROGMEM = "scheduler";
+static const char name_profile[] PROGMEM = "profile";
+static const char name_keys[] PROGMEM = "keys";
+static const char name_arena[] PROGMEM = "arena";
+static const char name_trace[] PROGMEM = "trace";
+static const char name_settings[] PROGMEM = "settings";
+static const char name_console[] PROGMEM = "console";
+static const char name_eequeue[] PROGMEM = "eequeue";
+#if TELEMETRY
+static const char name_telemetry[] PROGMEM = "telemetry";
+#endif
+
+static const ModuleUsage modules[] PROGMEM = {
+	{ name_display, &display_sram_bytes },
+	{ name_serialio, &serialio_sram_bytes },
+	{ name_leaderboard, &leaderboard_sram_bytes },
+	{ name_game, &game_sram_bytes },
+	{ name_sound, &sound_sram_bytes },
+	{ name_scheduler, &scheduler_sram_bytes },
+	{ name_profile, &profile_sram_bytes },
+	{ name_keys, &keys_sram_bytes },
+	{ name_arena, &arena_sram_bytes },
+	{ name_trace, &trace_sram_bytes },
+	{ name_settings, &settings_sram_bytes },
+	{ name_console, &console_sram_bytes },
+	{ name_eequeue, &eequeue_sram_bytes },
+#if TELEMETRY
+	{ name_telemetry, &telemetry_sram_bytes },
+#endif
+};
+#define NUM_MODULES (sizeof(modules)/sizeof(modules[0]))
+
+uint16_t sram_static_bytes(void) {
+	return (&__data_end - &__data_start) + (&__bss_end - &__bss_start);
+}
+
+uint16_t stack_free_now(void) {
+	return SP - (uint16_t)&_end;
+}
+
+uint16_t stack_free_min(void) {
+	const uint8_t* p = &_end;
+	while (p <= &__stack && *p == STACK_PAINT) {
+		p++;
+	}
+	return p - &_end;
+}
+
+void print_sram_report(uint8_t x, uint8_t y) {
+	uint16_t listed = 0;
+	
+	set_display_attribute(TERM_RESET);
+	move_cursor(x, y);
+	printf_P(PSTR("SRAM: %u bytes static (.data %u, .bss %u), %u free"),
+		sram_static_bytes(), (uint16_t)(&__data_end - &__data_start),
+		(uint16_t)(&__bss_end - &__bss_start), stack_free_now());
+	clear_to_end_of_line();
+	for (uint8_t i = 0; i < NUM_MODULES; i++) {
+		PGM_P name = (PGM_P)pgm_read_word(&modules[i].name);
+		uint16_t bytes = pgm_read_word(pgm_read_word(&modules[i].bytes));
+		listed += bytes;
+		move_cursor(x, y+i+1);
+		printf_P(PSTR("  %-12S %4u"), name, bytes);
+		clear_to_end_of_line();
+	}
+	move_cursor(x, y+NUM_MODULES+1);
+	printf_P(PSTR("  %-12S %4u"), PSTR("(other)"), sram_static_bytes() - listed);
+	clear_to_end_of_line();
+}
+
+void print_stack_free(uint8_t x, uint8_t y) {
+	move_cursor(x, y);
+	printf_P(PSTR("Stack: %u bytes free, %u at worst"),
+		stack_free_now(), stack_free_min());
+	clear_to_end_of_line();
+}
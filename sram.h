@@ -0,0 +1,51 @@
+/*
+ * sram.h
+ *
+ * Created: 19/10/2026 3:08:41 PM
+ *  Author: Kenton
+ *
+ * SRAM usage. The ATmega324A only has 2K of SRAM, shared between the
+ * static variables (.data and .bss, from the bottom) and the stack (from
+ * the top). We don't use malloc() so there is no heap in between.
+ *
+ * At reset, before main() runs, everything between the end of the static
+ * variables and the top of the stack is painted with STACK_PAINT. The
+ * stack overwrites the paint as it grows, so counting the bytes of paint
+ * left above the statics gives how close the stack has ever come to them.
+ *
+ * Modules with sizeable state declare how much they use with
+ * SRAM_USAGE() so the boot report can break the static usage down.
+ */
+
+
+#ifndef SRAM_H_
+#define SRAM_H_
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#define STACK_PAINT 0xC5
+
+// Record the number of bytes of SRAM used by a module's variables, e.g.
+// SRAM_USAGE(keys, sizeof(state) + sizeof(params));
+// The module must also be added to the table in sram.c.
+#define SRAM_USAGE(module, bytes) \
+	const uint16_t module##_sram_bytes PROGMEM = (bytes)
+
+// Bytes used by static variables (.data and .bss)
+uint16_t sram_static_bytes(void);
+
+// Bytes currently free between the static variables and the stack
+uint16_t stack_free_now(void);
+
+// Bytes between the static variables and the deepest the stack has
+// been since reset (the high-water mark)
+uint16_t stack_free_min(void);
+
+// Print the static usage of each module and the free SRAM
+void print_sram_report(uint8_t x, uint8_t y);
+
+// Print a one line summary of the free stack
+void print_stack_free(uint8_t x, uint8_t y);
+
+#endif /* SRAM_H_ */
@@ -0,0 +1,112 @@
+/*
+ * telemetry.c
+ *
+ * Created: 20/10/2026 7:20:58 PM
+ *  Author: Kenton
+ */
+
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "telemetry.h"
+#include "isrstats.h"
+#include "sram.h"
+
+#if TELEMETRY
+
+#define SYSCLK 8000000L
+
+static char out_buffer[TELEMETRY_BUFFER_SIZE];
+static volatile uint8_t out_head;	// next byte to send
+static volatile uint8_t out_count;	// bytes waiting
+
+uint8_t emit_to_telemetry;
+static uint8_t redirect_depth;
+static FILE* saved_stdout;
+
+SRAM_USAGE(telemetry, sizeof(out_buffer) + sizeof(out_head)
+	+ sizeof(out_count) + sizeof(emit_to_telemetry)
+	+ sizeof(redirect_depth) + sizeof(saved_stdout));
+
+static int telemetry_put_char(char c, FILE* stream) {
+	// Translate \n into \r\n, as serialio.c does for stdout
+	if (c == '\n') {
+		telemetry_put_char('\r', stream);
+	}
+	return telemetry_put_byte(c);
+}
+
+static FILE telemetry_stream = FDEV_SETUP_STREAM(telemetry_put_char, NULL,
+	_FDEV_SETUP_WRITE);
+
+void init_telemetry(void) {
+	out_head = 0;
+	out_count = 0;
+	emit_to_telemetry = 0;
+	redirect_depth = 0;
+	
+	// Double speed, so the divider is SYSCLK/(8*baud) - 1
+	UCSR1A = (1<<U2X1);
+	UBRR1 = SYSCLK / (8 * TELEMETRY_BAUD) - 1;
+	
+	// Transmit only - RXD1 is D2, which drives the seven segment
+	// display's digit select. The data register empty interrupt is
+	// enabled when there's something to send.
+	UCSR1B = (1<<TXEN1);
+}
+
+int8_t telemetry_put_byte(char c) {
+	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
+	if (out_count >= TELEMETRY_BUFFER_SIZE) {
+		if (!interruptsOn) {
+			return 1;
+		}
+		while (out_count >= TELEMETRY_BUFFER_SIZE) {
+			/* wait for the interrupt handler to make room */
+		}
+	}
+	
+	cli();
+	out_buffer[(uint8_t)(out_head + out_count) % TELEMETRY_BUFFER_SIZE] = c;
+	out_count++;
+	UCSR1B |= (1<<UDRIE1);
+	if (interruptsOn) {
+		sei();
+	}
+	return 0;
+}
+
+uint8_t telemetry_backlog(void) {
+	return out_count;
+}
+
+void telemetry_begin(void) {
+	if (redirect_depth++ == 0) {
+		saved_stdout = stdout;
+		stdout = &telemetry_stream;
+		emit_to_telemetry = 1;
+	}
+}
+
+void telemetry_end(void) {
+	if (--redirect_depth == 0) {
+		stdout = saved_stdout;
+		emit_to_telemetry = 0;
+	}
+}
+
+ISR(USART1_UDRE_vect) {
+	ISR_STATS_ENTER();
+	if (out_count > 0) {
+		UDR1 = out_buffer[out_head];
+		out_head = (out_head + 1) % TELEMETRY_BUFFER_SIZE;
+		out_count--;
+	} else {
+		// Nothing left - stop the interrupt until there is
+		UCSR1B &= ~(1<<UDRIE1);
+	}
+	ISR_STATS_EXIT(ISR_USART1_UDRE);
+}
+
+#endif /* TELEMETRY */
@@ -0,0 +1,70 @@
+/*
+ * telemetry.h
+ *
+ * Created: 20/10/2026 7:20:51 PM
+ *  Author: Kenton
+ *
+ * Output-only second serial port on USART1 for instrumentation, so
+ * statistics, the event trace and debug output don't take bandwidth
+ * from (or scribble over) the game terminal on USART0. It has its own
+ * interrupt driven output buffer and runs at TELEMETRY_BAUD with the
+ * double speed (U2X) divider.
+ *
+ * Wrap instrumentation output in telemetry_begin() and telemetry_end().
+ * In between, stdout (printf() and friends) and the emit.h functions
+ * write to USART1 instead of USART0.
+ *
+ * USART1 transmits on pin D3, which is otherwise switch 3. That's why
+ * TELEMETRY is off by default. With it on, disconnect the switch, wire
+ * D3 to the RX line of a second USB serial adaptor, and the switch reads
+ * as off (see SWITCH_D3()). D2 (RXD1) is left alone. With TELEMETRY off,
+ * everything goes to USART0 as before.
+ */
+
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "serialio.h"
+
+#ifndef TELEMETRY
+#define TELEMETRY 0
+#endif
+
+// 8MHz / (8 * (3+1)) - exact with U2X
+#define TELEMETRY_BAUD 250000L
+#define TELEMETRY_BUFFER_SIZE 128
+
+#if TELEMETRY
+// Whether emit.h output is going to USART1 (set by telemetry_begin())
+extern uint8_t emit_to_telemetry;
+
+// Set up USART1. Interrupts must be enabled globally afterwards.
+void init_telemetry(void);
+
+// Add a byte to the output buffer. Like serial_put_byte(), this waits
+// for room if interrupts are enabled and otherwise drops the byte and
+// returns 1.
+int8_t telemetry_put_byte(char c);
+
+// Bytes waiting to be sent
+uint8_t telemetry_backlog(void);
+
+// Send stdout and emit.h output to USART1 until telemetry_end(). Pairs
+// of calls can be nested.
+void telemetry_begin(void);
+void telemetry_end(void);
+
+#define SWITCH_D3()	0
+#else
+#define init_telemetry()
+#define telemetry_backlog()	serial_output_backlog()
+#define telemetry_begin()
+#define telemetry_end()
+
+#define SWITCH_D3()	(PIND & (1<<PIND3))
+#endif
+
+#endif /* TELEMETRY_H_ */
@@ -10,12 +10,13 @@
 #include <avr/pgmspace.h>
 
 #include "terminalio.h"
+#include "emit.h"
 
 DisplayParameter currentMode = TERM_RESET;
 DisplayParameter sCurrentMode = TERM_RESET;
 
 void move_cursor(int x, int y) {
-    printf_P(PSTR("\x1b[%d;%dH"), y, x);
+	emit_csi_num2(y, x, 'H');
 }
 
 void s_invalidate_mode() {
@@ -24,9 +25,17 @@ void s_invalidate_mode() {
 }
 
 
+// The s_ functions write into arr (without a null terminator) and
+// return the number of characters written
 uint8_t s_move_cursor(char* arr, uint8_t x, uint8_t y){
-	sprintf_P(arr, PSTR("\x1b[%d;%dH"), y, x);
-	return 6 + (y>=10) + (x>=10);
+	uint8_t len = 2;
+	arr[0] = '\x1b';
+	arr[1] = '[';
+	len += format_u8(arr+len, y);
+	arr[len++] = ';';
+	len += format_u8(arr+len, x);
+	arr[len++] = 'H';
+	return len;
 }
 
 uint8_t s_fast_set_display_attr(char* arr, DisplayParameter mode) {
@@ -34,37 +43,41 @@ uint8_t s_fast_set_display_attr(char* arr, DisplayParameter mode) {
 		return 0;
 	}
 	sCurrentMode = mode;
-	sprintf_P(arr, PSTR("\x1b[%dm"), mode);
-	return 4 + (mode>= 10);
+	uint8_t len = 2;
+	arr[0] = '\x1b';
+	arr[1] = '[';
+	len += format_u8(arr+len, mode);
+	arr[len++] = 'm';
+	return len;
 }
 
 void normal_display_mode(void) {
-	printf_P(PSTR("\x1b[0m"));
+	emit_P(PSTR("\x1b[0m"));
 }
 
 void reverse_video(void) {
-	printf_P(PSTR("\x1b[7m"));
+	emit_P(PSTR("\x1b[7m"));
 }
 
 void clear_terminal(void) {
-	printf_P(PSTR("\x1b[2J"));
+	emit_P(PSTR("\x1b[2J"));
 }
 
 void clear_to_end_of_line(void) {
-	printf_P(PSTR("\x1b[K"));
+	emit_P(PSTR("\x1b[K"));
 }
 
 void set_display_attribute(DisplayParameter parameter) {
 	currentMode = parameter;
-	printf_P(PSTR("\x1b[%dm"), parameter);
+	emit_csi_num(parameter, 'm');
 }
 
 void hide_cursor() {
-	printf_P(PSTR("\x1b[?25l"));
+	emit_P(PSTR("\x1b[?25l"));
 }
 
 void show_cursor() {
-	printf_P(PSTR("\x1b[?25h"));
+	emit_P(PSTR("\x1b[?25h"));
 }
 
 void enable_scrolling_for_whole_display(void) {
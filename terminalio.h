@@ -29,6 +29,15 @@
 #define W_GAME_OVER 30
 #define H_GAME_OVER 4
 
+// where diagnostic tables (e.g. the profiler) are printed - to the right
+// of everything else
+#define X_STATS 40
+#define Y_STATS Y_TOP
+
+// the I/O bandwidth status line (two lines, above the tables)
+#define X_IO_STATUS X_STATS
+#define Y_IO_STATUS Y_TITLE
+
 #include <stdint.h>
 /*
  * x (column number) and y (row number) are measured relative to the top
@@ -6,19 +6,60 @@
  * We setup timer0 to generate an interrupt every 1ms
  * We update a global clock tick variable - whose value
  * can be retrieved using the get_clock_ticks() function.
+ *
+ * Regular work driven by the timer (score display, music) is split in
+ * two. The interrupt handler only does what has to happen on time - it
+ * counts down to each job and does any port writes - and flags the rest
+ * as a "bottom half" which the main loop runs via run_timer0_bottom_halves().
+ * The old handler, which did everything itself, can still be built for
+ * comparison (TIMER0_BOTTOM_HALVES in timer0.h).
  */
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+#include <stdio.h>
 
 #include "score.h"
 #include "sound.h"
 #include "timer0.h"
+#include "isrstats.h"
+#include "terminalio.h"
 
 /* Our internal clock tick count - incremented every 
  * millisecond. Will overflow every ~49 days. */
 static volatile uint32_t clockTicks;
 
+/* Intervals (in milliseconds) of the jobs run from the timer. */
+#define SCORE_TICK_INTERVAL 10
+#define SOUND_TICK_INTERVAL 31
+
+#if TIMER0_BOTTOM_HALVES
+/* Countdowns to the next run of each job. We count down rather than
+ * testing clockTicks % interval since that would be a 32 bit division
+ * every millisecond.
+ */
+static uint8_t scoreCountdown = SCORE_TICK_INTERVAL;
+static uint8_t soundCountdown = SOUND_TICK_INTERVAL;
+
+/* Number of runs of each bottom half waiting to be done by the main
+ * loop. These are counts rather than flags so that if the main loop
+ * is held up no sound ticks are lost (which would upset the tempo).
+ */
+static volatile uint8_t scorePending;
+static volatile uint8_t soundPending;
+#endif
+
+/* Benchmark figures - the longest the interrupt handler has taken (in
+ * timer counts since the compare match, so including the interrupt
+ * latency) and the longest run of the bottom halves. Build with
+ * TIMER0_BOTTOM_HALVES set to 0 to measure the old handler the same way.
+ */
+static volatile uint8_t isrMaxCounts;
+#if TIMER0_BOTTOM_HALVES
+static uint16_t bottomHalfMaxCounts;
+#endif
+
 /* Set up timer 0 to generate an interrupt every 1ms. 
  * We will divide the clock by 64 and count up to 124.
  * We will therefore get an interrupt every 64 x 125
@@ -68,19 +109,143 @@ uint32_t get_current_time(void) {
 	 */
 	uint8_t interruptsOn = bit_is_set(SREG, SREG_I);
 	cli();
+	CLI_STATS_ENTER();
 	returnValue = clockTicks;
+	CLI_STATS_EXIT(CLI_GET_CURRENT_TIME);
 	if(interruptsOn) {
 		sei();
 	}
 	return returnValue;
 }
 
+uint16_t get_timer0_count(void) {
+	uint8_t count = TCNT0;
+	uint16_t ticks = clockTicks;
+	
+	/* If the compare match has happened but the interrupt hasn't been
+	 * handled yet (interrupts are off) then the counter has already
+	 * been reset and the tick count is one behind.
+	 */
+	if((TIFR0 & (1<<OCF0A)) && count < TIMER0_COUNTS_PER_MS/2) {
+		ticks++;
+	}
+	return ticks*TIMER0_COUNTS_PER_MS + count;
+}
+
+void run_timer0_bottom_halves(void) {
+#if TIMER0_BOTTOM_HALVES
+	uint8_t score, sound;
+	uint16_t start;
+	
+	cli();
+	score = scorePending;
+	sound = soundPending;
+	scorePending = 0;
+	soundPending = 0;
+	start = get_timer0_count();
+	sei();
+	
+	if (!score && !sound) {
+		return;
+	}
+	
+	if (score) {
+		/* Only the latest score matters - no need to catch up */
+		update_score_segments();
+	}
+	while (sound--) {
+		tick_sound();
+	}
+	
+	cli();
+	uint16_t elapsed = get_timer0_count() - start;
+	sei();
+	if (elapsed > bottomHalfMaxCounts) {
+		bottomHalfMaxCounts = elapsed;
+	}
+#endif
+}
+
+uint8_t timer0_bottom_halves_pending(void) {
+#if TIMER0_BOTTOM_HALVES
+	return scorePending || soundPending;
+#else
+	return 0;
+#endif
+}
+
+void print_timer0_stats(uint8_t x, uint8_t y) {
+	move_cursor(x, y);
+#if TIMER0_BOTTOM_HALVES
+	printf_P(PSTR("Timer0 ISR max %u cycles, bottom halves max %lu cycles"),
+		isrMaxCounts*TIMER0_CYCLES_PER_COUNT,
+		(uint32_t)bottomHalfMaxCounts*TIMER0_CYCLES_PER_COUNT);
+#else
+	printf_P(PSTR("Timer0 ISR (old, no bottom halves) max %u cycles"),
+		isrMaxCounts*TIMER0_CYCLES_PER_COUNT);
+#endif
+	clear_to_end_of_line();
+}
+
+uint16_t get_fast_time(void) {
+	/* The low 16 bits of clockTicks (the AVR is little endian). */
+	const volatile uint16_t* fastTicks = (const volatile uint16_t*)&clockTicks;
+	uint16_t first, second;
+	
+	/* Reading 16 bits takes two instructions and the interrupt could
+	 * fire in between, giving a torn value. Read twice and retry if they
+	 * differ - the interrupt only fires once a millisecond so the second
+	 * attempt will always succeed.
+	 */
+	do {
+		first = *fastTicks;
+		second = *fastTicks;
+	} while(first != second);
+	return first;
+}
+
 ISR(TIMER0_COMPA_vect) {
+	ISR_STATS_ENTER();
+	
 	/* Increment our clock tick count */
 	clockTicks++;
 	
-	if (clockTicks % 10 == 0)
-		update_score_tick();
-	if (clockTicks % 31 == 0)
+#if TIMER0_BOTTOM_HALVES
+	if (--scoreCountdown == 0) {
+		scoreCountdown = SCORE_TICK_INTERVAL;
+		/* Multiplexing the seven segment display has to happen on
+		 * time or it flickers - this is just port writes.
+		 */
+		display_score_digit();
+		if (scorePending < 255) {
+			scorePending++;
+		}
+	}
+	if (--soundCountdown == 0) {
+		soundCountdown = SOUND_TICK_INTERVAL;
+		if (soundPending < 255) {
+			soundPending++;
+		}
+	}
+#else
+	/* The old handler. update_score_segments() stands in for the old
+	 * update_score_tick(), which worked the digits out every time
+	 * rather than only when the score changed.
+	 */
+	if (clockTicks % SCORE_TICK_INTERVAL == 0) {
+		update_score_segments();
+		display_score_digit();
+	}
+	if (clockTicks % SOUND_TICK_INTERVAL == 0) {
 		tick_sound();
+	}
+#endif
+	
+	/* TCNT0 has been counting since the compare match */
+	uint8_t elapsed = TCNT0;
+	if (elapsed > isrMaxCounts) {
+		isrMaxCounts = elapsed;
+	}
+	
+	ISR_STATS_EXIT(ISR_TIMER0_COMPA);
 }
@@ -20,6 +20,16 @@
 
 #include <stdint.h>
 
+/* Set TIMER0_BOTTOM_HALVES to 0 to build the old interrupt handler,
+ * which did the score display and music work itself and used 32 bit
+ * divisions to decide when. It is only kept so the handler's worst case
+ * can be measured both ways (print_timer0_stats(), or simbench's
+ * "make timer0-compare").
+ */
+#ifndef TIMER0_BOTTOM_HALVES
+#define TIMER0_BOTTOM_HALVES 1
+#endif
+
 /* Set up our timer to give us an interrupt every millisecond
  * and update our time reference.
  */
@@ -30,4 +40,49 @@ void init_timer0(void);
  */
 uint32_t get_current_time(void);
 
+/* Return the low 16 bits of the current clock tick value. This doesn't
+ * disable interrupts so is cheap enough to call from hot loops. It
+ * wraps around every ~65 seconds - compare times with the macros below.
+ */
+uint16_t get_fast_time(void);
+
+/* Wrap-safe comparisons for 16 bit times from get_fast_time(). These
+ * are correct as long as the two times are within ~32 seconds of each
+ * other (including across the wrap around).
+ * TIME_REACHED is true if now is at or after deadline.
+ * TIME_SINCE is the number of milliseconds from then to now.
+ */
+#define TIME_REACHED(now, deadline)	((int16_t)((uint16_t)(now) - (uint16_t)(deadline)) >= 0)
+#define TIME_SINCE(now, then)		((uint16_t)((uint16_t)(now) - (uint16_t)(then)))
+
+/* Timer 0 counts from 0 to 124 each millisecond, each count being 64
+ * clock cycles.
+ */
+#define TIMER0_COUNTS_PER_MS 125
+#define TIMER0_CYCLES_PER_COUNT 64
+
+/* Return a fine grained time in timer 0 counts (8 microseconds each).
+ * This wraps around every 65536 counts (~0.5 seconds) so is only good
+ * for measuring short intervals. Must be called with interrupts
+ * disabled.
+ */
+uint16_t get_timer0_count(void);
+
+/* Run the work deferred from the timer interrupt handler (updating the
+ * score display and stepping the music). Must be called regularly from
+ * the main loop.
+ */
+void run_timer0_bottom_halves(void);
+
+/* Return non-zero if there is deferred work waiting for
+ * run_timer0_bottom_halves(). Safe to call with interrupts off.
+ */
+uint8_t timer0_bottom_halves_pending(void);
+
+/* Print the worst case durations of the timer interrupt handler and of
+ * the deferred work at the given terminal position. (With the old
+ * handler there is no deferred work, so only the handler is shown.)
+ */
+void print_timer0_stats(uint8_t x, uint8_t y);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,283 @@
+/*
+ * bench.c
+ *
+ * Created: 20/10/2026 11:20:07 AM
+ *  Author: Kenton
+ *
+ * Microbenchmarks for the game.c primitives, built for the host. game.c
+ * is included directly so its static functions can be called, with the
+ * display/score/sound calls going to stubs.c. random() is wrapped so
+ * the number of calls (and so the number of retries in
+ * add_asteroid_in_rows()) can be counted.
+ *
+ * Each primitive is run at several field densities (asteroids on the
+ * field) and reported as operations per second along with the mean and
+ * worst value of an iteration count - loop iterations, array shifts or
+ * placement retries. The counts are exact; the rates are only useful
+ * for comparing one version of game.c against another on the same
+ * machine.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stubs.h"
+
+static uint32_t random_calls;
+
+static long counted_random(void) {
+	random_calls++;
+	return random();
+}
+
+#define random counted_random
+#include "game.c"
+#undef random
+
+#define TRIALS 2000		// random fields per density
+#define REPEATS 200		// timed operations per field
+
+static const uint8_t densities[] = { 0, 5, 10, 15, 19, 20 };
+
+typedef struct {
+	uint64_t ops;
+	uint64_t ns;
+	uint64_t count_total;
+	uint32_t count_worst;
+	uint32_t failures;
+} Result;
+
+static volatile int8_t sink;
+
+static uint64_t now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static void count(Result* r, uint32_t n) {
+	r->count_total += n;
+	if (n > r->count_worst) {
+		r->count_worst = n;
+	}
+}
+
+// A field with the given number of asteroids placed the way
+// initialise_game() places them (anywhere but the bottom three rows),
+// no projectiles and the base in the middle.
+static void fill_field(uint8_t density) {
+	numAsteroids = 0;
+	numProjectiles = 0;
+	basePosition = 3;
+	while (numAsteroids < density) {
+		add_asteroid_in_rows(3);
+	}
+}
+
+static void print_result(const char* name, uint8_t density, Result* r,
+		const char* counting) {
+	printf("%-22s %7u %13.0f %9.2f %7u %8u  %s\n", name, density,
+		r->ops * 1e9 / (r->ns ? r->ns : 1),
+		r->ops ? (double)r->count_total / r->ops : 0.0,
+		r->count_worst, r->failures, counting);
+}
+
+///////////////////////////////////////////////////////////////////////
+
+static void bench_asteroid_at(uint8_t density) {
+	Result r = {0};
+	uint8_t xs[REPEATS], ys[REPEATS];
+	for (int t = 0; t < TRIALS; t++) {
+		fill_field(density);
+		for (int i = 0; i < REPEATS; i++) {
+			xs[i] = random() % FIELD_WIDTH;
+			ys[i] = random() % FIELD_HEIGHT;
+		}
+		uint64_t start = now_ns();
+		for (int i = 0; i < REPEATS; i++) {
+			sink = asteroid_at(xs[i], ys[i]);
+		}
+		r.ns += now_ns() - start;
+		r.ops += REPEATS;
+		// Loop iterations - the whole list on a miss
+		for (int i = 0; i < REPEATS; i++) {
+			int8_t found = asteroid_at(xs[i], ys[i]);
+			count(&r, found == -1 ? numAsteroids : found + 1);
+		}
+	}
+	print_result("asteroid_at", density, &r, "loop iterations");
+}
+
+static void bench_add_asteroid(const char* name, uint8_t density,
+		uint8_t blockedRows) {
+	Result r = {0};
+	if (density >= MAX_ASTEROIDS) {
+		return;
+	}
+	for (int t = 0; t < TRIALS; t++) {
+		fill_field(density);
+		for (int i = 0; i < REPEATS; i++) {
+			random_calls = 0;
+			uint64_t start = now_ns();
+			add_asteroid_in_rows(blockedRows);
+			r.ns += now_ns() - start;
+			r.ops++;
+			// Two random() calls per attempt. The retries are the
+			// attempts which hit an occupied position.
+			uint8_t added = (numAsteroids > density);
+			count(&r, random_calls/2 - added);
+			r.failures += !added;
+			numAsteroids = density;
+		}
+	}
+	print_result(name, density, &r, "placement retries");
+}
+
+// Insertion sort shifts are the number of pairs which are out of order
+// (by row) before sorting.
+static uint32_t count_inversions(void) {
+	uint32_t inversions = 0;
+	for (uint8_t i = 0; i < numAsteroids; i++) {
+		for (uint8_t j = i+1; j < numAsteroids; j++) {
+			inversions += GET_Y_POSITION(asteroids[i]) > GET_Y_POSITION(asteroids[j]);
+		}
+	}
+	return inversions;
+}
+
+static void bench_sort_asteroids(uint8_t density) {
+	Result r = {0};
+	uint8_t unsorted[MAX_ASTEROIDS];
+	for (int t = 0; t < TRIALS; t++) {
+		fill_field(density);
+		memcpy(unsorted, asteroids, sizeof(asteroids));
+		count(&r, count_inversions());
+		// The copy back is included in the time
+		uint64_t start = now_ns();
+		for (int i = 0; i < REPEATS; i++) {
+			memcpy(asteroids, unsorted, sizeof(asteroids));
+			sort_asteroids();
+		}
+		r.ns += now_ns() - start;
+		r.ops += REPEATS;
+	}
+	// count() was only called once per field
+	r.count_total *= REPEATS;
+	print_result("sort_asteroids", density, &r, "insertion shifts");
+}
+
+static void bench_remove_asteroid(uint8_t density) {
+	Result r = {0};
+	uint8_t saved[MAX_ASTEROIDS];
+	if (density == 0) {
+		return;
+	}
+	for (int t = 0; t < TRIALS; t++) {
+		fill_field(density);
+		memcpy(saved, asteroids, sizeof(asteroids));
+		uint64_t start = now_ns();
+		for (int i = 0; i < REPEATS; i++) {
+			remove_asteroid(i % density);
+			memcpy(asteroids, saved, sizeof(asteroids));
+			numAsteroids = density;
+		}
+		r.ns += now_ns() - start;
+		r.ops += REPEATS;
+		for (int i = 0; i < REPEATS; i++) {
+			count(&r, density - 1 - i % density);
+		}
+	}
+	print_result("remove_asteroid", density, &r, "array shifts");
+}
+
+// A whole asteroid tick starting from the given density. The tick tops
+// the field back up to MAX_ASTEROIDS in the top row, so the random()
+// calls count is dominated by how many asteroids are missing.
+static void bench_advance_asteroids(uint8_t density) {
+	Result r = {0};
+	uint8_t saved[MAX_ASTEROIDS];
+	for (int t = 0; t < TRIALS/10; t++) {
+		fill_field(density);
+		memcpy(saved, asteroids, sizeof(asteroids));
+		for (int i = 0; i < REPEATS; i++) {
+			random_calls = 0;
+			uint64_t start = now_ns();
+			advance_asteroids();
+			r.ns += now_ns() - start;
+			r.ops++;
+			count(&r, random_calls);
+			r.failures += (numAsteroids < MAX_ASTEROIDS);
+			memcpy(asteroids, saved, sizeof(asteroids));
+			numAsteroids = density;
+			basePosition = 3;
+		}
+	}
+	print_result("advance_asteroids", density, &r, "random() calls");
+}
+
+// A projectile tick with every projectile in flight, spread along the
+// base's column. Hits go through check_asteroid_hit().
+static void bench_advance_projectiles(uint8_t density) {
+	Result r = {0};
+	uint8_t saved[MAX_ASTEROIDS];
+	uint8_t saved_projectiles[MAX_PROJECTILES];
+	for (int t = 0; t < TRIALS/10; t++) {
+		fill_field(density);
+		for (uint8_t p = 0; p < MAX_PROJECTILES; p++) {
+			projectiles[p] = GAME_POSITION(random() % FIELD_WIDTH, 2 + p*3);
+		}
+		numProjectiles = MAX_PROJECTILES;
+		memcpy(saved, asteroids, sizeof(asteroids));
+		memcpy(saved_projectiles, projectiles, sizeof(projectiles));
+		for (int i = 0; i < REPEATS; i++) {
+			uint64_t start = now_ns();
+			advance_projectiles();
+			r.ns += now_ns() - start;
+			r.ops++;
+			// Each projectile that disappeared either hit something or
+			// went off the top
+			count(&r, MAX_PROJECTILES - numProjectiles);
+			memcpy(asteroids, saved, sizeof(asteroids));
+			memcpy(projectiles, saved_projectiles, sizeof(projectiles));
+			numAsteroids = density;
+			numProjectiles = MAX_PROJECTILES;
+		}
+	}
+	print_result("advance_projectiles", density, &r, "projectiles removed");
+}
+
+int main(int argc, char** argv) {
+	unsigned seed = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 0) : 1;
+	srandom(seed);
+
+	printf("seed %u, %d fields per density\n", seed, TRIALS);
+	printf("(failures: add_asteroid_in_rows giving up, or a tick leaving"
+		" the field short of %d asteroids)\n\n", MAX_ASTEROIDS);
+	printf("%-22s %7s %13s %9s %7s %8s  %s\n", "primitive", "density",
+		"ops/s", "mean", "worst", "failures", "counting");
+
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_asteroid_at(densities[i]);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_add_asteroid("add_asteroid_in_rows 3", densities[i], 3);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_add_asteroid("add_asteroid_in_rows 15", densities[i], FIELD_HEIGHT-1);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_sort_asteroids(densities[i]);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_remove_asteroid(densities[i]);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_advance_asteroids(densities[i]);
+	}
+	for (uint8_t i = 0; i < sizeof(densities); i++) {
+		bench_advance_projectiles(densities[i]);
+	}
+	return 0;
+}
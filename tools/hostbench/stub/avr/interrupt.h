@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for <avr/interrupt.h>. There are no interrupts on the
+ * host, so turning them off and on does nothing.
+ */
+
+#ifndef HOSTBENCH_AVR_INTERRUPT_H_
+#define HOSTBENCH_AVR_INTERRUPT_H_
+
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Host stand-in for <avr/io.h>. game.c and the headers it includes only
+ * need the header to exist; the one register they touch (SREG, saved
+ * and restored by TRACE()) is a plain variable in stubs.c.
+ */
+
+#ifndef HOSTBENCH_AVR_IO_H_
+#define HOSTBENCH_AVR_IO_H_
+
+#include <stdint.h>
+
+extern uint8_t SREG;
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for <avr/pgmspace.h> - program memory is just memory.
+ */
+
+#ifndef HOSTBENCH_AVR_PGMSPACE_H_
+#define HOSTBENCH_AVR_PGMSPACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define PGM_P const char*
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define printf_P printf
+
+#endif
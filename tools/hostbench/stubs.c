@@ -0,0 +1,66 @@
+/*
+ * stubs.c
+ *
+ * Created: 20/10/2026 11:05:41 AM
+ *  Author: Kenton
+ *
+ * Stand-ins for the display, terminal, score, sound, profiling and trace
+ * calls game.c makes, so the game logic can run on the host. They only
+ * count what they're asked to do.
+ */
+
+#include <stdint.h>
+
+#include "stubs.h"
+#include "terminalio.h"
+#include "trace.h"
+
+uint32_t stub_pixels;
+uint32_t stub_frames;
+int32_t stub_lives = 4;
+
+// TRACE() writes into the ring as it does on the AVR, so its cost is
+// included in the timings
+uint8_t SREG;
+volatile uint16_t cycle_overflows;
+TraceRecord trace_ring[TRACE_SIZE];
+uint16_t trace_written;
+uint8_t trace_full;
+
+void set_pixel(uint8_t x, uint8_t y, uint8_t colour) {
+	stub_pixels++;
+}
+
+void new_frame() {}
+
+void draw_frame() {
+	stub_frames++;
+}
+
+void print_terminal_buffer() {}
+void ledmatrix_clear(void) {}
+void s_invalidate_mode() {}
+void set_display_attribute(DisplayParameter parameter) {}
+void move_cursor(int x, int y) {}
+
+void add_to_score(int16_t value) {}
+
+void change_lives(int8_t change) {
+	// Never let the benchmarks end the game
+	if (stub_lives + change > 0) {
+		stub_lives += change;
+	}
+}
+
+int32_t get_lives(void) {
+	return stub_lives;
+}
+
+void play_track(uint8_t track) {}
+
+void profile_start(uint8_t region) {}
+void profile_end(uint8_t region) {}
+
+int8_t button_pushed(void) {
+	return -1;
+}
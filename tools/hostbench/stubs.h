@@ -0,0 +1,20 @@
+/*
+ * stubs.h
+ *
+ * Created: 20/10/2026 11:05:52 AM
+ *  Author: Kenton
+ *
+ * Counters kept by the host stand-ins in stubs.c.
+ */
+
+
+#ifndef STUBS_H_
+#define STUBS_H_
+
+#include <stdint.h>
+
+extern uint32_t stub_pixels;	// set_pixel() calls
+extern uint32_t stub_frames;	// draw_frame() calls
+extern int32_t stub_lives;
+
+#endif /* STUBS_H_ */
@@ -0,0 +1,255 @@
+/*
+ * ledsim.c
+ *
+ * Created: 20/10/2026 1:12:44 PM
+ *  Author: Kenton
+ */
+
+#include <string.h>
+
+#include "ledsim.h"
+
+// Shift directions (bits of the CMD_SHIFT_DISPLAY argument)
+#define SHIFT_RIGHT	0x01
+#define SHIFT_LEFT	0x02
+#define SHIFT_DOWN	0x04
+#define SHIFT_UP	0x08
+
+static const char* command_names[LEDSIM_NUM_CMDS] = {
+	"update_all", "update_pixel", "update_row", "update_col", "shift", "clear"
+};
+
+// Index into by_command[] of a command byte, or -1 if it isn't one
+static int command_index(uint8_t command) {
+	switch (command) {
+		case LEDSIM_CMD_UPDATE_ALL: return 0;
+		case LEDSIM_CMD_UPDATE_PIXEL: return 1;
+		case LEDSIM_CMD_UPDATE_ROW: return 2;
+		case LEDSIM_CMD_UPDATE_COL: return 3;
+		case LEDSIM_CMD_SHIFT_DISPLAY: return 4;
+		case LEDSIM_CMD_CLEAR_SCREEN: return 5;
+		default: return -1;
+	}
+}
+
+// Argument bytes after each command byte
+static uint8_t command_length(uint8_t command) {
+	switch (command) {
+		case LEDSIM_CMD_UPDATE_ALL: return LEDSIM_COLUMNS * LEDSIM_ROWS;
+		case LEDSIM_CMD_UPDATE_PIXEL: return 2;
+		case LEDSIM_CMD_UPDATE_ROW: return 1 + LEDSIM_COLUMNS;
+		case LEDSIM_CMD_UPDATE_COL: return 1 + LEDSIM_ROWS;
+		case LEDSIM_CMD_SHIFT_DISPLAY: return 1;
+		default: return 0;
+	}
+}
+
+static void error(LedSim* sim, const char* message, uint8_t byte) {
+	sim->frame.errors++;
+	if (sim->log) {
+		fprintf(sim->log, "ledsim: frame %u byte %u: %s (0x%02x)\n",
+			sim->frames, sim->frame.bytes, message, byte);
+	}
+}
+
+static void set(LedSim* sim, uint8_t x, uint8_t y, uint8_t colour) {
+	if (sim->fb[x][y] == colour) {
+		sim->frame.redundant_pixels++;
+	}
+	sim->fb[x][y] = colour;
+}
+
+static void shift(LedSim* sim, uint8_t direction) {
+	uint8_t old[LEDSIM_COLUMNS][LEDSIM_ROWS];
+	int dx = 0, dy = 0;
+	if (direction & SHIFT_RIGHT) dx++;
+	if (direction & SHIFT_LEFT) dx--;
+	if (direction & SHIFT_UP) dy++;
+	if (direction & SHIFT_DOWN) dy--;
+
+	memcpy(old, sim->fb, sizeof(old));
+	for (int x = 0; x < LEDSIM_COLUMNS; x++) {
+		for (int y = 0; y < LEDSIM_ROWS; y++) {
+			int from_x = x - dx, from_y = y - dy;
+			sim->fb[x][y] = (from_x >= 0 && from_x < LEDSIM_COLUMNS
+				&& from_y >= 0 && from_y < LEDSIM_ROWS) ? old[from_x][from_y] : 0;
+		}
+	}
+}
+
+void ledsim_init(LedSim* sim, FILE* log) {
+	memset(sim, 0, sizeof(*sim));
+	sim->log = log;
+}
+
+// Validate and remember the argument bytes that aren't colours
+static int check_argument(LedSim* sim, uint8_t byte) {
+	if (sim->received != 0) {
+		return 1;
+	}
+	switch (sim->command) {
+		case LEDSIM_CMD_UPDATE_PIXEL:
+			if (byte & 0x80) {
+				error(sim, "pixel y out of range", byte);
+				return 0;
+			}
+			break;
+		case LEDSIM_CMD_UPDATE_ROW:
+			if (byte >= LEDSIM_ROWS) {
+				error(sim, "row out of range", byte);
+				return 0;
+			}
+			break;
+		case LEDSIM_CMD_UPDATE_COL:
+			if (byte >= LEDSIM_COLUMNS) {
+				error(sim, "column out of range", byte);
+				return 0;
+			}
+			break;
+		case LEDSIM_CMD_SHIFT_DISPLAY:
+			if (byte == 0 || byte > 0x0F
+					|| (byte & (SHIFT_LEFT|SHIFT_RIGHT)) == (SHIFT_LEFT|SHIFT_RIGHT)
+					|| (byte & (SHIFT_UP|SHIFT_DOWN)) == (SHIFT_UP|SHIFT_DOWN)) {
+				error(sim, "bad shift direction", byte);
+				return 0;
+			}
+			break;
+	}
+	return 1;
+}
+
+void ledsim_byte(LedSim* sim, uint8_t byte) {
+	sim->frame.bytes++;
+
+	if (sim->expected == 0) {
+		// Start of a command
+		int index = command_index(byte);
+		if (index < 0) {
+			error(sim, "unknown command", byte);
+			return;
+		}
+		sim->command = byte;
+		sim->received = 0;
+		sim->expected = command_length(byte);
+		sim->frame.commands++;
+		sim->frame.by_command[index]++;
+		if (byte == LEDSIM_CMD_CLEAR_SCREEN) {
+			memset(sim->fb, 0, sizeof(sim->fb));
+		}
+		return;
+	}
+
+	if (!check_argument(sim, byte)) {
+		// Drop the rest of the command - we can't tell what it meant
+		sim->expected = 0;
+		return;
+	}
+
+	uint8_t n = sim->received;
+	switch (sim->command) {
+		case LEDSIM_CMD_UPDATE_ALL:
+			// Sent a row at a time from the bottom (ledmatrix_update_all())
+			set(sim, n % LEDSIM_COLUMNS, n / LEDSIM_COLUMNS, byte);
+			break;
+		case LEDSIM_CMD_UPDATE_PIXEL:
+			if (n == 0) {
+				sim->args[0] = byte;
+			} else {
+				set(sim, sim->args[0] & 0x0F, sim->args[0] >> 4, byte);
+			}
+			break;
+		case LEDSIM_CMD_UPDATE_ROW:
+			if (n == 0) {
+				sim->args[0] = byte;
+			} else {
+				set(sim, n-1, sim->args[0], byte);
+			}
+			break;
+		case LEDSIM_CMD_UPDATE_COL:
+			if (n == 0) {
+				sim->args[0] = byte;
+			} else {
+				set(sim, sim->args[0], n-1, byte);
+			}
+			break;
+		case LEDSIM_CMD_SHIFT_DISPLAY:
+			shift(sim, byte);
+			break;
+	}
+	sim->received++;
+	sim->expected--;
+}
+
+int ledsim_idle(LedSim* sim) {
+	return sim->expected == 0;
+}
+
+static void fold(uint32_t* total, uint32_t* max, uint32_t value) {
+	*total += value;
+	if (value > *max) {
+		*max = value;
+	}
+}
+
+void ledsim_end_frame(LedSim* sim) {
+	LedStats* f = &sim->frame;
+	fold(&sim->total.bytes, &sim->max.bytes, f->bytes);
+	fold(&sim->total.commands, &sim->max.commands, f->commands);
+	fold(&sim->total.errors, &sim->max.errors, f->errors);
+	fold(&sim->total.redundant_pixels, &sim->max.redundant_pixels, f->redundant_pixels);
+	for (int i = 0; i < LEDSIM_NUM_CMDS; i++) {
+		fold(&sim->total.by_command[i], &sim->max.by_command[i], f->by_command[i]);
+	}
+	memset(f, 0, sizeof(*f));
+	sim->frames++;
+}
+
+static char colour_char(uint8_t colour) {
+	switch (colour) {
+		case 0x00: return '.';
+		case 0x0F: return 'R';
+		case 0xF0: return 'G';
+		case 0xDF: return 'Y';
+		case 0x3C: return 'O';
+		case 0x13: return 'o';
+		case 0x35: return 'y';
+		case 0x11: return 'g';
+		default: return '#';
+	}
+}
+
+void ledsim_print_text(LedSim* sim, FILE* out) {
+	for (int y = LEDSIM_ROWS-1; y >= 0; y--) {
+		for (int x = 0; x < LEDSIM_COLUMNS; x++) {
+			fputc(colour_char(sim->fb[x][y]), out);
+		}
+		fputc('\n', out);
+	}
+}
+
+void ledsim_write_ppm(LedSim* sim, FILE* out, int scale) {
+	fprintf(out, "P6\n%d %d\n255\n", LEDSIM_COLUMNS*scale, LEDSIM_ROWS*scale);
+	for (int y = LEDSIM_ROWS*scale - 1; y >= 0; y--) {
+		for (int x = 0; x < LEDSIM_COLUMNS*scale; x++) {
+			// Low nibble is red, high nibble green
+			uint8_t colour = sim->fb[x/scale][y/scale];
+			fputc((colour & 0x0F) * 17, out);
+			fputc((colour >> 4) * 17, out);
+			fputc(0, out);
+		}
+	}
+}
+
+void ledsim_print_stats(LedSim* sim, FILE* out) {
+	fprintf(out, "%-16s %10s %10s\n", "", "total", "frame max");
+	fprintf(out, "%-16s %10u\n", "frames", sim->frames);
+	fprintf(out, "%-16s %10u %10u\n", "bytes", sim->total.bytes, sim->max.bytes);
+	fprintf(out, "%-16s %10u %10u\n", "commands", sim->total.commands, sim->max.commands);
+	for (int i = 0; i < LEDSIM_NUM_CMDS; i++) {
+		fprintf(out, "  %-14s %10u %10u\n", command_names[i],
+			sim->total.by_command[i], sim->max.by_command[i]);
+	}
+	fprintf(out, "%-16s %10u %10u\n", "redundant pixels",
+		sim->total.redundant_pixels, sim->max.redundant_pixels);
+	fprintf(out, "%-16s %10u %10u\n", "errors", sim->total.errors, sim->max.errors);
+}
@@ -0,0 +1,84 @@
+/*
+ * ledsim.h
+ *
+ * Created: 20/10/2026 1:12:36 PM
+ *  Author: Kenton
+ *
+ * Host emulator of the LED matrix board. It takes the bytes the firmware
+ * sends over SPI (ledmatrix.c) one at a time and keeps a 16x8
+ * framebuffer laid out the same way as MatrixData, i.e. fb[x][y] with
+ * y = 0 at the bottom. Every command is checked against the protocol,
+ * and bytes, commands and wasted pixel writes are counted per frame. The
+ * caller decides where a frame ends (e.g. at each draw_frame())
+ * by calling ledsim_end_frame().
+ */
+
+
+#ifndef LEDSIM_H_
+#define LEDSIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define LEDSIM_COLUMNS 16
+#define LEDSIM_ROWS 8
+
+// Command bytes (ledmatrix.c)
+#define LEDSIM_CMD_UPDATE_ALL		0x00
+#define LEDSIM_CMD_UPDATE_PIXEL		0x01
+#define LEDSIM_CMD_UPDATE_ROW		0x02
+#define LEDSIM_CMD_UPDATE_COL		0x03
+#define LEDSIM_CMD_SHIFT_DISPLAY	0x04
+#define LEDSIM_CMD_CLEAR_SCREEN		0x0F
+#define LEDSIM_NUM_CMDS				6
+
+typedef struct {
+	uint32_t bytes;
+	uint32_t commands;
+	uint32_t by_command[LEDSIM_NUM_CMDS];	// in the order above
+	uint32_t errors;
+	uint32_t redundant_pixels;	// pixel writes that didn't change the colour
+} LedStats;
+
+typedef struct {
+	uint8_t fb[LEDSIM_COLUMNS][LEDSIM_ROWS];
+
+	// Command being received
+	uint8_t command;
+	uint8_t expected;	// argument bytes still to come (0 = waiting for a command)
+	uint8_t received;
+	uint8_t args[2];
+
+	uint32_t frames;
+	LedStats frame;		// the current frame
+	LedStats total;		// everything so far
+	LedStats max;		// largest value of each field in any one frame
+
+	// Protocol errors are described here (if set)
+	FILE* log;
+} LedSim;
+
+void ledsim_init(LedSim* sim, FILE* log);
+
+// Feed one byte received over SPI
+void ledsim_byte(LedSim* sim, uint8_t byte);
+
+// Finish the current frame, folding its counts into the totals
+void ledsim_end_frame(LedSim* sim);
+
+// 1 if the last command has been received completely
+int ledsim_idle(LedSim* sim);
+
+// Print the framebuffer as 8 lines of 16 characters, top row first.
+// '.' is black; the named colours of pixel_colour.h are R, G, Y, O,
+// o (light orange), y (light yellow) and g (light green). Any other
+// colour is '#'.
+void ledsim_print_text(LedSim* sim, FILE* out);
+
+// Write the framebuffer as a binary PPM, each LED scale pixels square
+void ledsim_write_ppm(LedSim* sim, FILE* out, int scale);
+
+// Print the counts for the current frame, totals and per-frame maxima
+void ledsim_print_stats(LedSim* sim, FILE* out);
+
+#endif /* LEDSIM_H_ */
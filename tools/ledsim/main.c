@@ -0,0 +1,106 @@
+/*
+ * main.c
+ *
+ * Created: 20/10/2026 1:40:02 PM
+ *  Author: Kenton
+ *
+ * Command line front end to the LED matrix emulator. Reads a capture of
+ * the SPI byte stream - hex bytes, one frame per line, '#' comments (as
+ * written by simbench --captures) - and prints the counts, and the
+ * frames as text and/or a PPM image. Exits with status 1 if the stream
+ * breaks the protocol.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ledsim.h"
+
+static void usage(void) {
+	fprintf(stderr, "usage: ledsim [--every-frame] [--text] [--ppm <file>] "
+		"[--scale <n>] [capture]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	const char* ppm_path = NULL;
+	const char* capture = NULL;
+	int every_frame = 0, text = 0, scale = 16;
+	LedSim sim;
+	char line[4096];
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--every-frame") == 0) {
+			every_frame = 1;
+		} else if (strcmp(argv[i], "--text") == 0) {
+			text = 1;
+		} else if (strcmp(argv[i], "--ppm") == 0 && i+1 < argc) {
+			ppm_path = argv[++i];
+		} else if (strcmp(argv[i], "--scale") == 0 && i+1 < argc) {
+			scale = atoi(argv[++i]);
+		} else if (argv[i][0] == '-' || capture) {
+			usage();
+		} else {
+			capture = argv[i];
+		}
+	}
+	if (scale < 1) {
+		usage();
+	}
+
+	FILE* in = capture ? fopen(capture, "r") : stdin;
+	if (!in) {
+		perror(capture);
+		return 2;
+	}
+	ledsim_init(&sim, stderr);
+	while (fgets(line, sizeof(line), in)) {
+		char* p = line;
+		if (line[0] == '#') {
+			continue;
+		}
+		while (*p) {
+			char* end;
+			unsigned long byte = strtoul(p, &end, 16);
+			if (end == p) {
+				if (!isspace((unsigned char)*p)) {
+					fprintf(stderr, "ledsim: bad byte '%c' in capture\n", *p);
+					return 2;
+				}
+				p++;
+				continue;
+			}
+			ledsim_byte(&sim, (uint8_t)byte);
+			p = end;
+		}
+		ledsim_end_frame(&sim);
+		if (every_frame) {
+			printf("frame %u\n", sim.frames);
+			ledsim_print_text(&sim, stdout);
+		}
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	if (text && !every_frame) {
+		ledsim_print_text(&sim, stdout);
+	}
+	if (ppm_path) {
+		FILE* out = fopen(ppm_path, "wb");
+		if (!out) {
+			perror(ppm_path);
+			return 2;
+		}
+		ledsim_write_ppm(&sim, out, scale);
+		fclose(out);
+	}
+	ledsim_print_stats(&sim, stdout);
+	if (!ledsim_idle(&sim)) {
+		fprintf(stderr, "ledsim: capture ends part way through a command\n");
+		return 1;
+	}
+	return sim.total.errors ? 1 : 0;
+}
@@ -0,0 +1,1166 @@
+/*
+ * simbench.c
+ *
+ * Created: 20/10/2026 9:40:18 AM
+ *  Author: Kenton
+ *
+ * Runs the firmware under simavr and measures it while playing scripted
+ * scenarios. See README.md for the scenario language, the report and the
+ * thresholds file.
+ *
+ * Measurements come from three places:
+ *  - the simulator itself: cycles, bytes out of the SPI and UART, and the
+ *    lowest the stack pointer goes
+ *  - SIM_MARK() writes to GPIOR0 (simmark.h), which give exact cycle
+ *    counts for each profiled region (profile.h)
+ *  - the firmware's own counters, read out of SRAM using the addresses
+ *    from avr-nm (isr_stats from isrstats.h)
+ *  - the LED matrix emulator (tools/ledsim), which is fed the SPI bytes
+ *    and checks them against the matrix protocol
+ *  - the terminal model (tools/vtsim), which is fed the UART output and
+ *    which the check_field command compares against the game state
+ *
+ * The firmware is built with the USART1 telemetry port on (telemetry.h).
+ * Its output is counted, captured and, with --pty, copied to a pseudo
+ * terminal so it can be watched live.
+ *
+ * The latency command times inputs from the button edge or key press to
+ * the first LED pixel and terminal character they change.
+ */
+
+#define _GNU_SOURCE		// for the pseudo terminal functions
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_irq.h"
+#include "sim_io.h"
+#include "avr_uart.h"
+#include "avr_spi.h"
+#include "avr_ioport.h"
+
+#include "ledsim.h"
+#include "vtsim.h"
+
+#define F_CPU 8000000UL
+#define CYCLES_PER_MS (F_CPU/1000)
+
+// Data space address of GPIOR0 on the ATmega324A (I/O address 0x1E)
+#define GPIOR0_ADDR 0x3E
+
+// Gap between bytes sent to the UART (a little slower than 19200 baud)
+#define UART_BYTE_CYCLES (CYCLES_PER_MS*6/10)
+
+// How long a button is held down for
+#define BUTTON_HOLD_MS 20
+
+// Must match profile.h
+#define SIM_REGION_START	0x80
+#define SIM_REGION_END		0xC0
+#define NUM_REGIONS 4
+#define PROFILE_DRAW_FRAME 2
+static const char* region_names[NUM_REGIONS] = {
+	"advance_asteroids", "advance_projectiles", "draw_frame",
+	"print_terminal_buffer"
+};
+
+// Must match isrstats.h. Each IsrStats is a packed uint32 count,
+// uint32 total (in 8 cycle timer counts) and uint8 max.
+#define NUM_ISR_VECTORS 9
+#define ISR_STATS_SIZE 9
+#define ISR_CYCLES_PER_COUNT 8
+static const char* vector_names[NUM_ISR_VECTORS] = {
+	"timer0_compa", "usart0_udre", "usart0_rx", "adc", "pcint1", "pcint3",
+	"timer2_ovf", "usart1_udre", "ee_ready"
+};
+
+// Must match scheduler.h/scheduler.c. Each Task is a packed function
+// pointer, uint16 deadline, uint16 interval, uint8 flags, uint16 runs
+// and uint16 max_lateness.
+#define TASK_SIZE 11
+#define TASK_MAX_LATENESS 9
+#define MAX_TASKS 8
+
+///////////////////////////////////////////////////////////////////////
+// Symbols (from avr-nm)
+
+typedef struct {
+	char name[64];
+	uint32_t address;
+} Symbol;
+
+static Symbol* symbols;
+static int num_symbols;
+
+static void load_symbols(const char* path) {
+	FILE* f = fopen(path, "r");
+	char line[256];
+	int capacity = 0;
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long address;
+		char type;
+		char name[64];
+		if (sscanf(line, "%lx %c %63s", &address, &type, name) != 3) {
+			continue;
+		}
+		if (num_symbols == capacity) {
+			capacity = capacity ? capacity*2 : 256;
+			symbols = realloc(symbols, capacity * sizeof(Symbol));
+		}
+		strcpy(symbols[num_symbols].name, name);
+		symbols[num_symbols].address = address;
+		num_symbols++;
+	}
+	fclose(f);
+}
+
+// Data space address of a variable, or -1 if there's no such symbol
+static long data_address(const char* name) {
+	for (int i = 0; i < num_symbols; i++) {
+		if (strcmp(symbols[i].name, name) == 0
+				&& symbols[i].address >= 0x800000) {
+			return symbols[i].address - 0x800000;
+		}
+	}
+	return -1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Measurements for the current scenario
+
+typedef struct {
+	uint64_t start;
+	int open;
+	uint32_t count;
+	uint64_t total, min, max;
+} Region;
+
+typedef struct {
+	uint64_t start_cycle;
+	Region regions[NUM_REGIONS];
+	uint32_t spi_bytes;
+	uint32_t uart_tx_bytes;
+	uint32_t uart_rx_bytes;
+	uint32_t telemetry_bytes;
+	uint16_t min_sp;
+	uint8_t isr_start[NUM_ISR_VECTORS * ISR_STATS_SIZE];
+} Measurement;
+
+static avr_t* avr;
+static Measurement m;
+
+// The LED matrix, and where its byte stream is being captured (if
+// --captures was given). A frame ends at each draw_frame().
+static LedSim led;
+static FILE* capture;
+
+// The terminal, likewise. Its frames end at each draw_frame(), but since
+// the UART output is interrupt driven, a frame's bytes are those sent
+// between one draw_frame() and the next rather than those it queued.
+#define TERMINAL_COLUMNS 120
+#define TERMINAL_ROWS 40
+static VtSim vt;
+static FILE* tty_capture;
+static uint64_t last_uart_cycle;
+static uint32_t field_checks, field_mismatches, field_unsettled;
+
+// The telemetry port (USART1) - captured like the terminal, and copied
+// to a pseudo terminal if --pty was given
+static FILE* telemetry_capture;
+static int pty = -1;
+
+// Input to display latencies (the latency command)
+#define LATENCY_TIMEOUT_MS 1000
+#define MAX_LATENCY_SAMPLES 1000
+#define MAX_LATENCY_KINDS 4
+
+typedef struct {
+	char name[32];
+	uint32_t led[MAX_LATENCY_SAMPLES];	// in cycles
+	uint32_t term[MAX_LATENCY_SAMPLES];
+	int led_samples, term_samples;
+	uint32_t missed;	// inputs which didn't show up in time
+	uint32_t skipped;	// inputs which couldn't have shown anything
+} Latency;
+
+static Latency latencies[MAX_LATENCY_KINDS];
+static int num_latencies;
+
+// Bytes waiting to be sent to the UART
+static char uart_queue[4096];
+static int uart_queue_len;
+static uint64_t uart_next_cycle;
+
+static void read_isr_stats(uint8_t* dest) {
+	long address = data_address("isr_stats");
+	if (address < 0) {
+		memset(dest, 0, NUM_ISR_VECTORS * ISR_STATS_SIZE);
+	} else {
+		memcpy(dest, avr->data + address, NUM_ISR_VECTORS * ISR_STATS_SIZE);
+	}
+}
+
+static uint16_t stack_pointer(void) {
+	return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+static void start_measurement(void) {
+	memset(&m, 0, sizeof(m));
+	m.start_cycle = avr->cycle;
+	m.min_sp = stack_pointer();
+	read_isr_stats(m.isr_start);
+	// Keep the matrix contents and any command in progress
+	led.frames = 0;
+	memset(&led.frame, 0, sizeof(led.frame));
+	memset(&led.total, 0, sizeof(led.total));
+	memset(&led.max, 0, sizeof(led.max));
+	vt.frames = 0;
+	memset(&vt.frame, 0, sizeof(vt.frame));
+	memset(&vt.total, 0, sizeof(vt.total));
+	memset(&vt.max, 0, sizeof(vt.max));
+	field_checks = field_mismatches = field_unsettled = 0;
+	num_latencies = 0;
+}
+
+static void marker_write(avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param) {
+	uint8_t region = v & 0x3F;
+	if (region >= NUM_REGIONS) {
+		return;
+	}
+	Region* r = &m.regions[region];
+	if ((v & 0xC0) == SIM_REGION_START) {
+		r->start = avr->cycle;
+		r->open = 1;
+	} else if ((v & 0xC0) == SIM_REGION_END && r->open) {
+		uint64_t elapsed = avr->cycle - r->start;
+		if (r->count == 0 || elapsed < r->min) {
+			r->min = elapsed;
+		}
+		if (elapsed > r->max) {
+			r->max = elapsed;
+		}
+		r->total += elapsed;
+		r->count++;
+		r->open = 0;
+		if (region == PROFILE_DRAW_FRAME) {
+			vtsim_end_frame(&vt);
+			if (tty_capture) {
+				fputc('\n', tty_capture);
+			}
+			if (telemetry_capture) {
+				fputc('\n', telemetry_capture);
+			}
+			ledsim_end_frame(&led);
+			if (capture) {
+				fputc('\n', capture);
+			}
+		}
+	}
+}
+
+// A display change being waited for by the latency command. The cycle
+// each one first shows up on is noted as the bytes arrive.
+typedef struct {
+	int active;
+	uint8_t led_x, led_y, colour;	// LED matrix position and colour
+	uint8_t term_x, term_y;			// terminal position (1 based)
+	char c;
+	uint64_t led_cycle, term_cycle;	// 0 until seen
+} Watch;
+
+static Watch watch;
+
+static void spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	m.spi_bytes++;
+	ledsim_byte(&led, (uint8_t)value);
+	if (watch.active && !watch.led_cycle && ledsim_idle(&led)
+			&& led.fb[watch.led_x][watch.led_y] == watch.colour) {
+		watch.led_cycle = avr->cycle;
+	}
+	if (capture) {
+		fprintf(capture, "%02x ", (uint8_t)value);
+	}
+}
+
+static void uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	m.uart_tx_bytes++;
+	last_uart_cycle = avr->cycle;
+	vtsim_byte(&vt, (uint8_t)value);
+	if (watch.active && !watch.term_cycle
+			&& vtsim_cell(&vt, watch.term_x, watch.term_y)->c == watch.c) {
+		watch.term_cycle = avr->cycle;
+	}
+	if (tty_capture) {
+		fprintf(tty_capture, "%02x ", (uint8_t)value);
+	}
+}
+
+static void telemetry_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+	uint8_t byte = value;
+	m.telemetry_bytes++;
+	if (telemetry_capture) {
+		fprintf(telemetry_capture, "%02x ", byte);
+	}
+	if (pty >= 0) {
+		// Dropped if nobody is reading and the pty fills up
+		(void)write(pty, &byte, 1);
+	}
+}
+
+// Open a pseudo terminal for the telemetry output and say where it is
+static void open_pty(void) {
+	pty = posix_openpt(O_RDWR | O_NOCTTY);
+	if (pty < 0 || grantpt(pty) != 0 || unlockpt(pty) != 0) {
+		perror("pty");
+		exit(2);
+	}
+	fcntl(pty, F_SETFL, fcntl(pty, F_GETFL) | O_NONBLOCK);
+	fprintf(stderr, "telemetry (USART1) on %s\n", ptsname(pty));
+}
+
+///////////////////////////////////////////////////////////////////////
+// Running
+
+static avr_irq_t* uart_input_irq;
+static avr_irq_t* button_irqs[4];
+
+// Run the simulation until the given cycle, feeding queued UART input
+// and tracking the stack pointer. Returns 0 if the firmware crashed.
+static int run_until(uint64_t end) {
+	while (avr->cycle < end) {
+		if (uart_queue_len && avr->cycle >= uart_next_cycle) {
+			m.uart_rx_bytes++;
+			avr_raise_irq(uart_input_irq, (uint8_t)uart_queue[0]);
+			memmove(uart_queue, uart_queue+1, --uart_queue_len);
+			uart_next_cycle = avr->cycle + UART_BYTE_CYCLES;
+		}
+		int state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed) {
+			return 0;
+		}
+		uint16_t sp = stack_pointer();
+		if (sp < m.min_sp) {
+			m.min_sp = sp;
+		}
+	}
+	return 1;
+}
+
+static int run_ms(uint32_t ms) {
+	return run_until(avr->cycle + (uint64_t)ms * CYCLES_PER_MS);
+}
+
+// Wait until the UART input queue has been sent
+static int drain_uart(void) {
+	while (uart_queue_len) {
+		if (!run_until(avr->cycle + UART_BYTE_CYCLES)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void queue_uart(const char* s, int len) {
+	if (uart_queue_len + len > (int)sizeof(uart_queue)) {
+		fprintf(stderr, "UART input queue full\n");
+		exit(2);
+	}
+	memcpy(uart_queue + uart_queue_len, s, len);
+	uart_queue_len += len;
+}
+
+static int press_button(int button) {
+	avr_raise_irq(button_irqs[button], 1);
+	if (!run_ms(BUTTON_HOLD_MS)) {
+		return 0;
+	}
+	avr_raise_irq(button_irqs[button], 0);
+	return 1;
+}
+
+static void poke(const char* name, long offset, uint32_t value, int size) {
+	long address = data_address(name);
+	if (address < 0) {
+		fprintf(stderr, "poke: no variable called %s\n", name);
+		exit(2);
+	}
+	// little endian, like the AVR
+	for (int i = 0; i < size; i++) {
+		avr->data[address + offset + i] = (value >> (8*i)) & 0xFF;
+	}
+}
+
+static uint8_t peek(const char* name, int offset) {
+	long address = data_address(name);
+	if (address < 0) {
+		fprintf(stderr, "no variable called %s\n", name);
+		exit(2);
+	}
+	return avr->data[address + offset];
+}
+
+// Game field as drawn by display.c - must match game.c and terminalio.h
+#define FIELD_WIDTH 8
+#define FIELD_HEIGHT 16
+#define FIELD_TERM_X(x) ((x) + 3)	// X_LEFT+1
+#define FIELD_TERM_Y(y) (20 - (y))	// Y_BOTTOM-1
+#define MAX_SHOWN_MISMATCHES 8
+
+// What the terminal should show at a field position: the character and
+// its foreground colour (SGR 30+n)
+static void expected_cell(int x, int y, char* c, int* fg) {
+	int8_t base = (int8_t)peek("basePosition", 0);
+	uint8_t position = (x << 4) | y;
+	*c = ' ';
+	*fg = -1;
+	if ((y == 0 && x >= base-1 && x <= base+1) || (y == 1 && x == base)) {
+		*c = '#';
+		*fg = 3;
+		return;
+	}
+	for (int i = 0; i < (int8_t)peek("numProjectiles", 0); i++) {
+		if (peek("projectiles", i) == position) {
+			*c = '|';
+			*fg = 1;
+			return;
+		}
+	}
+	for (int i = 0; i < (int8_t)peek("numAsteroids", 0); i++) {
+		if (peek("asteroids", i) == position) {
+			*c = '@';
+			*fg = 2;
+			return;
+		}
+	}
+}
+
+// Wait for the terminal to catch up with the game - nothing buffered in
+// display.c or the serial output buffer, and a couple of milliseconds
+// since the last byte - then check that every cell of the field shows
+// what game.c thinks is there.
+static int check_field(void) {
+	uint64_t deadline = avr->cycle + 1000 * CYCLES_PER_MS;
+	while (peek("termIndex", 0) != 0 || peek("bytes_in_out_buffer", 0) != 0
+			|| avr->cycle - last_uart_cycle < 2 * CYCLES_PER_MS) {
+		if (avr->cycle >= deadline) {
+			field_unsettled++;
+			return 1;
+		}
+		if (!run_until(avr->cycle + CYCLES_PER_MS/10)) {
+			return 0;
+		}
+	}
+
+	uint32_t mismatches = 0;
+	for (int y = 0; y < FIELD_HEIGHT; y++) {
+		for (int x = 0; x < FIELD_WIDTH; x++) {
+			char c;
+			int fg;
+			expected_cell(x, y, &c, &fg);
+			VtCell* cell = vtsim_cell(&vt, FIELD_TERM_X(x), FIELD_TERM_Y(y));
+			if (cell->c == c && (fg < 0 || cell->attr.fg == fg)) {
+				continue;
+			}
+			if (mismatches++ < MAX_SHOWN_MISMATCHES) {
+				fprintf(stderr, "field (%d,%d): expected '%c' colour %d, terminal shows '%c' colour %d\n",
+					x, y, c, fg, cell->c, cell->attr.fg);
+			}
+		}
+	}
+	if (mismatches) {
+		vtsim_print_region(&vt, stderr, FIELD_TERM_X(-1), FIELD_TERM_Y(FIELD_HEIGHT),
+			FIELD_TERM_X(FIELD_WIDTH), FIELD_TERM_Y(-1));
+	}
+	field_checks++;
+	field_mismatches += mismatches;
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Input to display latency
+
+static Latency* find_latency(const char* name) {
+	for (int i = 0; i < num_latencies; i++) {
+		if (strcmp(latencies[i].name, name) == 0) {
+			return &latencies[i];
+		}
+	}
+	if (num_latencies == MAX_LATENCY_KINDS) {
+		fprintf(stderr, "too many kinds of latency\n");
+		exit(2);
+	}
+	Latency* l = &latencies[num_latencies++];
+	memset(l, 0, sizeof(*l));
+	snprintf(l->name, sizeof(l->name), "%s", name);
+	return l;
+}
+
+static int8_t field_object_at(const char* array, const char* count, uint8_t position) {
+	for (int i = 0; i < (int8_t)peek(count, 0); i++) {
+		if (peek(array, i) == position) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// One move or fire input, given after a random delay of up to max_phase
+// milliseconds so that it lands at a random point relative to the game's
+// ticks. Returns 0 if the firmware crashed.
+static int latency_trial(Latency* l, int fire, int use_button, uint32_t max_phase) {
+	uint64_t phase = (uint64_t)rand() % ((uint64_t)max_phase * CYCLES_PER_MS + 1);
+	if (!run_until(avr->cycle + phase)) {
+		return 0;
+	}
+
+	int8_t base = (int8_t)peek("basePosition", 0);
+	int x, y, button;
+	char key;
+	memset(&watch, 0, sizeof(watch));
+	if (fire) {
+		// The projectile appears above the base - unless there's no room
+		// for it or it would hit an asteroid straight away
+		x = base;
+		y = 2;
+		if ((int8_t)peek("numProjectiles", 0) >= 4
+				|| field_object_at("projectiles", "numProjectiles", (x << 4) | y) != -1
+				|| field_object_at("asteroids", "numAsteroids", (x << 4) | y) != -1) {
+			l->skipped++;
+			return 1;
+		}
+		watch.colour = 0x0F;	// COLOUR_RED
+		watch.c = '|';
+		button = 2;
+		key = ' ';
+	} else {
+		// Watch the top of the base in its new position
+		int right = base <= 0 ? 1 : base >= 7 ? 0 : rand() & 1;
+		x = right ? base+1 : base-1;
+		y = 1;
+		watch.colour = 0xDF;	// COLOUR_YELLOW
+		watch.c = '#';
+		button = right ? 0 : 3;
+		key = right ? 'r' : 'l';
+	}
+	watch.led_x = y;			// LED_MATRIX_POSN_FROM_XY() in display.c
+	watch.led_y = 7 - x;
+	watch.term_x = FIELD_TERM_X(x);
+	watch.term_y = FIELD_TERM_Y(y);
+	if (led.fb[watch.led_x][watch.led_y] == watch.colour
+			|| vtsim_cell(&vt, watch.term_x, watch.term_y)->c == watch.c) {
+		// Already showing - we couldn't tell when it changed
+		l->skipped++;
+		return 1;
+	}
+
+	// Wait for any earlier key to go, so this one is sent straight away
+	if (!use_button && !drain_uart()) {
+		return 0;
+	}
+	if (!use_button && avr->cycle < uart_next_cycle
+			&& !run_until(uart_next_cycle)) {
+		return 0;
+	}
+	uint64_t start = avr->cycle;
+	uint64_t release = start + (uint64_t)BUTTON_HOLD_MS * CYCLES_PER_MS;
+	uint64_t deadline = start + (uint64_t)LATENCY_TIMEOUT_MS * CYCLES_PER_MS;
+	watch.active = 1;
+	if (use_button) {
+		avr_raise_irq(button_irqs[button], 1);
+	} else {
+		queue_uart(&key, 1);
+	}
+	while ((!watch.led_cycle || !watch.term_cycle) && avr->cycle < deadline) {
+		if (!run_until(avr->cycle + CYCLES_PER_MS/10)) {
+			return 0;
+		}
+		if (use_button && release && avr->cycle >= release) {
+			avr_raise_irq(button_irqs[button], 0);
+			release = 0;
+		}
+	}
+	watch.active = 0;
+	if (use_button && release) {
+		if (!run_until(release)) {
+			return 0;
+		}
+		avr_raise_irq(button_irqs[button], 0);
+	}
+
+	if (!watch.led_cycle || !watch.term_cycle) {
+		l->missed++;
+	}
+	if (watch.led_cycle && l->led_samples < MAX_LATENCY_SAMPLES) {
+		l->led[l->led_samples++] = watch.led_cycle - start;
+	}
+	if (watch.term_cycle && l->term_samples < MAX_LATENCY_SAMPLES) {
+		l->term[l->term_samples++] = watch.term_cycle - start;
+	}
+	return 1;
+}
+
+// latency <move|fire> <button|key> <count> [max phase ms]
+static int run_latency(const char* args) {
+	char action[16], source[16], name[32];
+	int count, max_phase = 600;
+	if (sscanf(args, "%15s %15s %d %d", action, source, &count, &max_phase) < 3
+			|| (strcmp(action, "move") != 0 && strcmp(action, "fire") != 0)
+			|| (strcmp(source, "button") != 0 && strcmp(source, "key") != 0)) {
+		fprintf(stderr, "usage: latency <move|fire> <button|key> <count> [max phase ms]\n");
+		exit(2);
+	}
+	snprintf(name, sizeof(name), "%s_%s", action, source);
+	Latency* l = find_latency(name);
+	for (int i = 0; i < count; i++) {
+		if (!latency_trial(l, action[0] == 'f', source[0] == 'b', max_phase)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int compare_u32(const void* a, const void* b) {
+	uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+	return (x > y) - (x < y);
+}
+
+// Nearest rank percentile, in microseconds
+static double percentile_us(uint32_t* samples, int n, int percent) {
+	if (n == 0) {
+		return 0;
+	}
+	qsort(samples, n, sizeof(uint32_t), compare_u32);
+	int rank = (n * percent + 99) / 100;
+	return samples[rank ? rank-1 : 0] * 1e6 / F_CPU;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Scenario scripts
+
+// Parse a quoted string with C style escapes (\n \r \e \\ \" \xHH) into
+// out. Returns the length.
+static int parse_string(const char* s, char* out) {
+	int len = 0;
+	while (*s && *s != '"') {
+		s++;
+	}
+	if (*s++ != '"') {
+		return 0;
+	}
+	while (*s && *s != '"') {
+		char c = *s++;
+		if (c == '\\') {
+			c = *s++;
+			switch (c) {
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 'e': c = 27; break;
+				case 'x': c = (char)strtol(s, (char**)&s, 16); break;
+				default: break;
+			}
+		}
+		out[len++] = c;
+	}
+	return len;
+}
+
+static int run_script(const char* path) {
+	FILE* f = fopen(path, "r");
+	char line[256], str[256];
+	int line_num = 0;
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	start_measurement();
+	while (fgets(line, sizeof(line), f)) {
+		char command[32];
+		char* args;
+		int ok = 1;
+		line_num++;
+		if (sscanf(line, "%31s", command) != 1 || command[0] == '#') {
+			continue;
+		}
+		args = strstr(line, command) + strlen(command);
+
+		if (strcmp(command, "wait") == 0) {
+			ok = run_ms(strtoul(args, NULL, 10));
+		} else if (strcmp(command, "key") == 0) {
+			queue_uart(str, parse_string(args, str));
+			ok = drain_uart();
+		} else if (strcmp(command, "keys") == 0) {
+			// keys <count> <interval ms> "<string>"
+			char* rest;
+			unsigned long count = strtoul(args, &rest, 10);
+			unsigned long interval = strtoul(rest, &rest, 10);
+			int len = parse_string(rest, str);
+			for (unsigned long i = 0; ok && i < count; i++) {
+				queue_uart(str, len);
+				ok = drain_uart() && run_ms(interval);
+			}
+		} else if (strcmp(command, "button") == 0) {
+			ok = press_button(atoi(args) & 3);
+		} else if (strcmp(command, "poke") == 0) {
+			// poke <variable> <value> [size in bytes]
+			char name[64];
+			unsigned long value;
+			int size = 1;
+			if (sscanf(args, "%63s %li %d", name, (long*)&value, &size) < 2) {
+				fprintf(stderr, "%s:%d: bad poke\n", path, line_num);
+				exit(2);
+			}
+			poke(name, 0, value, size);
+		} else if (strcmp(command, "latency") == 0) {
+			ok = run_latency(args);
+		} else if (strcmp(command, "check_field") == 0) {
+			ok = check_field();
+		} else if (strcmp(command, "measure") == 0) {
+			start_measurement();
+		} else {
+			fprintf(stderr, "%s:%d: unknown command %s\n", path, line_num, command);
+			exit(2);
+		}
+		if (!ok) {
+			fprintf(stderr, "%s:%d: firmware crashed\n", path, line_num);
+			fclose(f);
+			return 0;
+		}
+	}
+	fclose(f);
+	return 1;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Results - a flat list of named metrics per scenario
+
+#define MAX_METRICS 192
+
+typedef struct {
+	char name[64];
+	double value;
+} Metric;
+
+typedef struct {
+	char name[64];
+	int completed;
+	int num_metrics;
+	Metric metrics[MAX_METRICS];
+} Result;
+
+static void add_metric(Result* r, const char* name, double value) {
+	if (r->num_metrics < MAX_METRICS) {
+		snprintf(r->metrics[r->num_metrics].name, 64, "%s", name);
+		r->metrics[r->num_metrics].value = value;
+		r->num_metrics++;
+	}
+}
+
+static void collect_results(Result* r) {
+	char name[64];
+	uint64_t cycles = avr->cycle - m.start_cycle;
+	uint8_t isr_end[NUM_ISR_VECTORS * ISR_STATS_SIZE];
+	double isr_total = 0;
+
+	add_metric(r, "cycles", cycles);
+	add_metric(r, "sim_ms", (double)cycles / CYCLES_PER_MS);
+
+	for (int i = 0; i < NUM_REGIONS; i++) {
+		Region* reg = &m.regions[i];
+		snprintf(name, sizeof(name), "region.%s.count", region_names[i]);
+		add_metric(r, name, reg->count);
+		snprintf(name, sizeof(name), "region.%s.min", region_names[i]);
+		add_metric(r, name, reg->min);
+		snprintf(name, sizeof(name), "region.%s.mean", region_names[i]);
+		add_metric(r, name, reg->count ? (double)reg->total / reg->count : 0);
+		snprintf(name, sizeof(name), "region.%s.max", region_names[i]);
+		add_metric(r, name, reg->max);
+	}
+
+	read_isr_stats(isr_end);
+	for (int i = 0; i < NUM_ISR_VECTORS; i++) {
+		uint32_t count_start, count_end, total_start, total_end;
+		memcpy(&count_start, m.isr_start + i*ISR_STATS_SIZE, 4);
+		memcpy(&count_end, isr_end + i*ISR_STATS_SIZE, 4);
+		memcpy(&total_start, m.isr_start + i*ISR_STATS_SIZE + 4, 4);
+		memcpy(&total_end, isr_end + i*ISR_STATS_SIZE + 4, 4);
+		double isr_cycles = (double)(total_end - total_start) * ISR_CYCLES_PER_COUNT;
+		isr_total += isr_cycles;
+		snprintf(name, sizeof(name), "isr.%s.count", vector_names[i]);
+		add_metric(r, name, count_end - count_start);
+		snprintf(name, sizeof(name), "isr.%s.cycles", vector_names[i]);
+		add_metric(r, name, isr_cycles);
+		snprintf(name, sizeof(name), "isr.%s.max", vector_names[i]);
+		add_metric(r, name, isr_end[i*ISR_STATS_SIZE + 8] * ISR_CYCLES_PER_COUNT);
+	}
+	add_metric(r, "isr.load_pct", cycles ? isr_total * 100.0 / cycles : 0);
+
+	add_metric(r, "spi.bytes", m.spi_bytes);
+	add_metric(r, "uart.tx_bytes", m.uart_tx_bytes);
+	add_metric(r, "uart.rx_bytes", m.uart_rx_bytes);
+	add_metric(r, "telemetry.bytes", m.telemetry_bytes);
+	uint32_t frames = m.regions[2].count;
+	add_metric(r, "spi.bytes_per_frame", frames ? (double)m.spi_bytes / frames : 0);
+	add_metric(r, "uart.bytes_per_frame", frames ? (double)m.uart_tx_bytes / frames : 0);
+
+	add_metric(r, "led.frames", led.frames);
+	add_metric(r, "led.commands", led.total.commands);
+	add_metric(r, "led.pixel_commands", led.total.by_command[1]);
+	add_metric(r, "led.redundant_pixels", led.total.redundant_pixels);
+	add_metric(r, "led.max_frame_bytes", led.max.bytes);
+	add_metric(r, "led.max_frame_commands", led.max.commands);
+	add_metric(r, "led.errors", led.total.errors + led.frame.errors);
+
+	add_metric(r, "vt.frames", vt.frames);
+	add_metric(r, "vt.sequences", vt.total.sequences + vt.frame.sequences);
+	add_metric(r, "vt.redundant_bytes", vt.total.redundant + vt.frame.redundant);
+	add_metric(r, "vt.redundant_pct", m.uart_tx_bytes
+		? (vt.total.redundant + vt.frame.redundant) * 100.0 / m.uart_tx_bytes : 0);
+	add_metric(r, "vt.max_frame_bytes", vt.max.bytes);
+	add_metric(r, "vt.max_frame_redundant", vt.max.redundant);
+	add_metric(r, "vt.unsupported", vt.total.unsupported + vt.frame.unsupported);
+	add_metric(r, "vt.string_bytes", vt.total.string_bytes + vt.frame.string_bytes);
+	add_metric(r, "vt.field_checks", field_checks);
+	add_metric(r, "vt.field_mismatches", field_mismatches);
+	add_metric(r, "vt.field_unsettled", field_unsettled);
+
+	for (int i = 0; i < num_latencies; i++) {
+		Latency* l = &latencies[i];
+		static const int percents[] = { 50, 99, 100 };
+		static const char* labels[] = { "p50", "p99", "max" };
+		for (int p = 0; p < 3; p++) {
+			snprintf(name, sizeof(name), "latency.%s.led_%s_us", l->name, labels[p]);
+			add_metric(r, name, percentile_us(l->led, l->led_samples, percents[p]));
+			snprintf(name, sizeof(name), "latency.%s.term_%s_us", l->name, labels[p]);
+			add_metric(r, name, percentile_us(l->term, l->term_samples, percents[p]));
+		}
+		snprintf(name, sizeof(name), "latency.%s.samples", l->name);
+		add_metric(r, name, l->led_samples);
+		snprintf(name, sizeof(name), "latency.%s.missed", l->name);
+		add_metric(r, name, l->missed);
+		snprintf(name, sizeof(name), "latency.%s.skipped", l->name);
+		add_metric(r, name, l->skipped);
+	}
+
+	// The latest any current task has run (since it was added). A
+	// deadline which has gone past the time it was checked against
+	// shows up here as ~65535.
+	long tasks = data_address("tasks");
+	long num_tasks = data_address("numTasks");
+	if (tasks >= 0 && num_tasks >= 0) {
+		uint16_t worst = 0;
+		for (int i = 0; i < avr->data[num_tasks] && i < MAX_TASKS; i++) {
+			const uint8_t* late = avr->data + tasks + i*TASK_SIZE + TASK_MAX_LATENESS;
+			uint16_t ms = late[0] | (late[1] << 8);
+			if (ms > worst) {
+				worst = ms;
+			}
+		}
+		add_metric(r, "tasks.max_lateness_ms", worst);
+	}
+
+	long end = data_address("_end");
+	if (end < 0) {
+		end = data_address("__bss_end");
+	}
+	add_metric(r, "stack.min_sp", m.min_sp);
+	add_metric(r, "stack.peak_bytes", avr->ramend - m.min_sp);
+	if (end >= 0) {
+		add_metric(r, "stack.free_bytes", (double)m.min_sp - end);
+	}
+}
+
+static int run_scenario(const char* firmware_path, const char* mcu,
+		const char* script, const char* captures, Result* r) {
+	elf_firmware_t firmware;
+	char path[512];
+	const char* base = strrchr(script, '/');
+	base = base ? base+1 : script;
+	snprintf(r->name, sizeof(r->name), "%.*s", (int)strcspn(base, "."), base);
+
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(firmware_path, &firmware) != 0) {
+		fprintf(stderr, "can't read %s\n", firmware_path);
+		exit(2);
+	}
+	avr = avr_make_mcu_by_name(mcu);
+	if (!avr) {
+		fprintf(stderr, "simavr doesn't know the %s\n", mcu);
+		exit(2);
+	}
+	avr_init(avr);
+	avr->frequency = F_CPU;
+	avr_load_firmware(avr, &firmware);
+
+	// Don't let simavr copy the UART output to our stdout
+	for (char uart = '0'; uart <= '1'; uart++) {
+		uint32_t flags = 0;
+		avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS(uart), &flags);
+		flags &= ~AVR_UART_FLAG_STDIO;
+		avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS(uart), &flags);
+	}
+
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'),
+		UART_IRQ_OUTPUT), uart_output, NULL);
+	uart_input_irq = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('1'),
+		UART_IRQ_OUTPUT), telemetry_output, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0),
+		SPI_IRQ_OUTPUT), spi_output, NULL);
+	for (int i = 0; i < 4; i++) {
+		button_irqs[i] = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), i);
+	}
+	avr_register_io_write(avr, GPIOR0_ADDR, marker_write, NULL);
+	uart_queue_len = 0;
+	uart_next_cycle = 0;
+
+	ledsim_init(&led, stderr);
+	vtsim_init(&vt, TERMINAL_COLUMNS, TERMINAL_ROWS, stderr);
+	srand(1);	// the same random input phases every run
+	last_uart_cycle = 0;
+	capture = NULL;
+	tty_capture = NULL;
+	telemetry_capture = NULL;
+	if (captures) {
+		snprintf(path, sizeof(path), "%s/%s.spi", captures, r->name);
+		capture = fopen(path, "w");
+		snprintf(path, sizeof(path), "%s/%s.tty", captures, r->name);
+		tty_capture = fopen(path, "w");
+		snprintf(path, sizeof(path), "%s/%s.tel", captures, r->name);
+		telemetry_capture = fopen(path, "w");
+		if (!capture || !tty_capture || !telemetry_capture) {
+			perror(path);
+			exit(2);
+		}
+		fprintf(capture, "# SPI bytes from scenario %s, one frame per line\n", r->name);
+		fprintf(tty_capture, "# Terminal bytes from scenario %s, one frame per line\n", r->name);
+		fprintf(telemetry_capture, "# Telemetry bytes from scenario %s, one frame per line\n", r->name);
+	}
+
+	r->completed = run_script(script);
+	collect_results(r);
+	avr_terminate(avr);
+
+	if (tty_capture) {
+		fclose(tty_capture);
+		fclose(telemetry_capture);
+		// The screen as it was left
+		snprintf(path, sizeof(path), "%s/%s.screen", captures, r->name);
+		FILE* screen = fopen(path, "w");
+		if (screen) {
+			vtsim_print_screen(&vt, screen);
+			fclose(screen);
+		}
+	}
+	if (capture) {
+		fclose(capture);
+		// The matrix as it was left
+		snprintf(path, sizeof(path), "%s/%s.ppm", captures, r->name);
+		FILE* ppm = fopen(path, "wb");
+		if (ppm) {
+			ledsim_write_ppm(&led, ppm, 16);
+			fclose(ppm);
+		}
+	}
+	return r->completed;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Thresholds - lines of "<scenario>.<metric> <= <value>" (or >=),
+// optionally followed by "estimate". An estimated limit that fails is
+// only a warning. With --baseline, a copy of the file is written with
+// each estimate replaced by the measured value plus headroom.
+
+// Look up a metric. Returns 0 if the scenario didn't report it.
+static int find_metric(Result* results, int num_results, const char* scenario,
+		const char* metric, double* value) {
+	for (int i = 0; i < num_results; i++) {
+		if (strcmp(results[i].name, scenario) != 0) {
+			continue;
+		}
+		for (int j = 0; j < results[i].num_metrics; j++) {
+			if (strcmp(results[i].metrics[j].name, metric) == 0) {
+				*value = results[i].metrics[j].value;
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+// A limit headroom percent looser than value, rounded outwards
+static double with_headroom(const char* op, double value, double headroom) {
+	if (strcmp(op, ">=") == 0) {
+		return floor(value * (1 - headroom/100));
+	}
+	return ceil(value * (1 + headroom/100));
+}
+
+static int check_thresholds(const char* path, Result* results, int num_results,
+		FILE* out, FILE* baseline, double headroom) {
+	FILE* f = fopen(path, "r");
+	char line[256];
+	int failures = 0, first = 1;
+	if (!f) {
+		perror(path);
+		exit(2);
+	}
+	fprintf(out, "  \"thresholds\": [");
+	while (fgets(line, sizeof(line), f)) {
+		char key[128], op[3], mark[16] = "";
+		double limit, value = 0;
+		if (line[0] == '#' || sscanf(line, "%127s %2s %lf %15s", key, op, &limit, mark) < 3) {
+			if (baseline) {
+				fputs(line, baseline);
+			}
+			continue;
+		}
+		int estimate = strcmp(mark, "estimate") == 0;
+		char* dot = strchr(key, '.');
+		if (!dot) {
+			continue;
+		}
+		*dot = '\0';
+		const char* metric = dot+1;
+		// Scenarios which weren't run are skipped, but a metric missing
+		// from one which was is a failure (the name is probably wrong)
+		int ran = 0;
+		for (int i = 0; i < num_results; i++) {
+			ran |= strcmp(results[i].name, key) == 0;
+		}
+		if (!ran) {
+			if (baseline) {
+				fputs(line, baseline);
+			}
+			continue;
+		}
+		int measured = find_metric(results, num_results, key, metric, &value);
+		int pass = measured && (strcmp(op, ">=") == 0 ? value >= limit : value <= limit);
+		if (!measured) {
+			fprintf(stderr, "FAIL %s.%s not measured\n", key, metric);
+		} else if (!pass) {
+			fprintf(stderr, "%s %s.%s = %.10g (limit %s %.10g)\n",
+				estimate ? "WARN" : "FAIL", key, metric, value, op, limit);
+		}
+		if (!pass && (!estimate || !measured)) {
+			failures++;
+		}
+		fprintf(out, "%s\n    {\"scenario\": \"%s\", \"metric\": \"%s\", "
+			"\"op\": \"%s\", \"limit\": %.10g, \"value\": %.10g, "
+			"\"estimate\": %s, \"pass\": %s}",
+			first ? "" : ",", key, metric, op, limit, measured ? value : 0,
+			estimate ? "true" : "false", pass ? "true" : "false");
+		first = 0;
+		if (baseline) {
+			if (estimate && measured) {
+				fprintf(baseline, "%s.%s %s %.10g\t# measured %.10g, %g%% headroom\n",
+					key, metric, op, with_headroom(op, value, headroom), value, headroom);
+			} else {
+				fputs(line, baseline);
+			}
+		}
+	}
+	fprintf(out, "\n  ],\n");
+	fclose(f);
+	return failures;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: simbench --firmware <elf> --symbols <avr-nm output> "
+		"[--mcu <name>] [--thresholds <file>] [--out <report.json>] "
+		"[--captures <dir>] [--pty] [--baseline <file> <headroom percent>] "
+		"scenario.txt...\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	const char* firmware = NULL;
+	const char* symbol_file = NULL;
+	const char* thresholds = NULL;
+	const char* out_path = NULL;
+	const char* captures = NULL;
+	const char* baseline_path = NULL;
+	double headroom = 0;
+	const char* mcu = "atmega324a";
+	const char* scenarios[64];
+	int num_scenarios = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--firmware") == 0 && i+1 < argc) {
+			firmware = argv[++i];
+		} else if (strcmp(argv[i], "--symbols") == 0 && i+1 < argc) {
+			symbol_file = argv[++i];
+		} else if (strcmp(argv[i], "--thresholds") == 0 && i+1 < argc) {
+			thresholds = argv[++i];
+		} else if (strcmp(argv[i], "--captures") == 0 && i+1 < argc) {
+			captures = argv[++i];
+		} else if (strcmp(argv[i], "--out") == 0 && i+1 < argc) {
+			out_path = argv[++i];
+		} else if (strcmp(argv[i], "--mcu") == 0 && i+1 < argc) {
+			mcu = argv[++i];
+		} else if (strcmp(argv[i], "--baseline") == 0 && i+2 < argc) {
+			baseline_path = argv[++i];
+			headroom = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--pty") == 0) {
+			open_pty();
+		} else if (argv[i][0] == '-' || num_scenarios == 64) {
+			usage();
+		} else {
+			scenarios[num_scenarios++] = argv[i];
+		}
+	}
+	if (!firmware || !symbol_file || num_scenarios == 0
+			|| (baseline_path && !thresholds)) {
+		usage();
+	}
+	load_symbols(symbol_file);
+
+	Result* results = calloc(num_scenarios, sizeof(Result));
+	int crashed = 0;
+	for (int i = 0; i < num_scenarios; i++) {
+		fprintf(stderr, "running %s\n", scenarios[i]);
+		crashed += !run_scenario(firmware, mcu, scenarios[i], captures, &results[i]);
+	}
+
+	FILE* out = out_path ? fopen(out_path, "w") : stdout;
+	if (!out) {
+		perror(out_path);
+		exit(2);
+	}
+	fprintf(out, "{\n  \"mcu\": \"%s\",\n  \"f_cpu\": %lu,\n", mcu, F_CPU);
+	FILE* baseline = NULL;
+	if (baseline_path && !(baseline = fopen(baseline_path, "w"))) {
+		perror(baseline_path);
+		exit(2);
+	}
+	int failures = thresholds ? check_thresholds(thresholds, results, num_scenarios,
+		out, baseline, headroom) : 0;
+	if (baseline) {
+		fclose(baseline);
+	}
+	fprintf(out, "  \"scenarios\": {");
+	for (int i = 0; i < num_scenarios; i++) {
+		Result* r = &results[i];
+		fprintf(out, "%s\n    \"%s\": {\n      \"completed\": %s", i ? "," : "",
+			r->name, r->completed ? "true" : "false");
+		for (int j = 0; j < r->num_metrics; j++) {
+			fprintf(out, ",\n      \"%s\": %.10g", r->metrics[j].name, r->metrics[j].value);
+		}
+		fprintf(out, "\n    }");
+	}
+	fprintf(out, "\n  },\n  \"failures\": %d\n}\n", failures + crashed);
+	if (out != stdout) {
+		fclose(out);
+	}
+	return (failures || crashed) ? 1 : 0;
+}
@@ -0,0 +1,374 @@
+/*
+ * decode_trace.c
+ *
+ * Created: 20/10/2026 6:41:10 PM
+ *  Author: Kenton
+ *
+ * Decoder for the firmware's event trace (trace.h). It reads a log of
+ * everything the board sent over the serial port, picks out the trace
+ * records (hex in APC strings - ESC _ T ... ESC \), and prints them as
+ * a timeline followed by frame time statistics: the time from each
+ * new_frame() to the draw_frame() that ends it, and the worst frames
+ * with the events around them.
+ *
+ * Timestamps are 16 bit 256 microsecond ticks, so they are unwrapped by
+ * assuming records are never more than ~16.8 seconds apart. A record
+ * earlier than the one before it means a new dump of the ring (which
+ * repeats what was sent before) and starts a new section.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+// Keep in step with trace.h
+#define TRACE_FRAME_START		1
+#define TRACE_FRAME_END			2
+#define TRACE_SPI_FLUSH			3
+#define TRACE_UART_BACKLOG		4
+#define TRACE_INPUT				5
+#define TRACE_FIRE				6
+#define TRACE_ASTEROID_SPAWN	7
+#define TRACE_ASTEROID_HIT		8
+#define TRACE_BASE_HIT			9
+#define TRACE_LOST				10
+
+#define US_PER_TICK 256
+#define RECORD_DIGITS 10
+
+typedef struct {
+	uint32_t tick;		// unwrapped
+	uint16_t raw;		// as sent
+	uint16_t section;
+	uint8_t type;
+	uint8_t a;
+	uint8_t b;
+} Record;
+
+typedef struct {
+	uint32_t start;		// index of the FRAME_START record
+	uint32_t end;		// index of the FRAME_END record
+	uint32_t ticks;
+} Frame;
+
+static Record* records;
+static uint32_t num_records, records_size;
+static Frame* frames;
+static uint32_t num_frames, frames_size;
+
+static uint32_t bad_records;
+
+static void usage(void) {
+	fprintf(stderr, "usage: decode_trace [--hex] [--stats] [--worst n] "
+		"[--context n] [log]\n");
+	exit(2);
+}
+
+static void* grow(void* array, uint32_t* size, size_t element) {
+	*size = *size ? *size * 2 : 1024;
+	array = realloc(array, *size * element);
+	if (!array) {
+		perror("decode_trace");
+		exit(2);
+	}
+	return array;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Reading the log
+
+// Read the whole log. With hex set it's in the form simbench writes
+// (hex bytes separated by white space) rather than raw bytes.
+static uint8_t* read_log(FILE* in, int hex, size_t* length) {
+	size_t size = 65536, n = 0;
+	uint8_t* data = malloc(size);
+	int c;
+	unsigned value = 0, digits = 0;
+	while (data && (c = fgetc(in)) != EOF) {
+		if (n == size) {
+			size *= 2;
+			data = realloc(data, size);
+			if (!data) {
+				break;
+			}
+		}
+		if (!hex) {
+			data[n++] = c;
+		} else if (isxdigit(c)) {
+			value = value*16 + (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+			digits++;
+		} else if (digits) {
+			data[n++] = value;
+			value = digits = 0;
+		}
+	}
+	if (!data) {
+		perror("decode_trace");
+		exit(2);
+	}
+	if (hex && digits) {
+		data[n++] = value;
+	}
+	*length = n;
+	return data;
+}
+
+static int hex_value(uint8_t c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+static uint8_t hex_byte(const uint8_t* p) {
+	return hex_value(p[0])*16 + hex_value(p[1]);
+}
+
+static void add_record(uint16_t tick, uint8_t type, uint8_t a, uint8_t b) {
+	static uint16_t section;
+	Record* r;
+	if (num_records == records_size) {
+		records = grow(records, &records_size, sizeof(Record));
+	}
+	r = &records[num_records];
+	if (num_records == 0) {
+		r->tick = tick;
+	} else {
+		Record* last = &records[num_records-1];
+		int16_t step = (int16_t)(tick - last->raw);
+		if (step < 0) {
+			// Gone backwards - a new dump
+			section++;
+		}
+		// Records in a new section are placed just after the last one.
+		// Only the times within a section mean anything.
+		r->tick = last->tick + (step < 0 ? 1 : step);
+	}
+	r->raw = tick;
+	r->section = section;
+	r->type = type;
+	r->a = a;
+	r->b = b;
+	num_records++;
+}
+
+// Decode the records in the APC string from p to end (after the T,
+// up to the ESC)
+static void parse_string(const uint8_t* p, const uint8_t* end) {
+	for (; p + RECORD_DIGITS <= end; p += RECORD_DIGITS) {
+		for (int i = 0; i < RECORD_DIGITS; i++) {
+			if (hex_value(p[i]) < 0) {
+				bad_records++;
+				return;
+			}
+		}
+		add_record(hex_byte(p) << 8 | hex_byte(p+2), hex_byte(p+4),
+			hex_byte(p+6), hex_byte(p+8));
+	}
+	if (p != end) {
+		bad_records++;
+	}
+}
+
+static void parse_log(const uint8_t* data, size_t length) {
+	for (size_t i = 0; i + 2 < length; i++) {
+		if (data[i] != 27 || data[i+1] != '_' || data[i+2] != 'T') {
+			continue;
+		}
+		size_t start = i + 3, end = start;
+		while (end < length && data[end] != 27) {
+			end++;
+		}
+		if (end + 1 >= length || data[end+1] != '\\') {
+			bad_records++;	// cut off
+			continue;
+		}
+		parse_string(&data[start], &data[end]);
+		i = end + 1;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+// Output
+
+static double ms(uint32_t ticks) {
+	return ticks * (US_PER_TICK / 1000.0);
+}
+
+static void print_position(char* buf, size_t size, uint8_t position) {
+	snprintf(buf, size, "(%u,%u)", position >> 4, position & 0x0F);
+}
+
+static void print_record(uint32_t index, uint32_t first_tick, const char* marker) {
+	Record* r = &records[index];
+	static const char* sources[] = { "button", "joystick", "key" };
+	char what[64], pos[16];
+
+	switch (r->type) {
+		case TRACE_FRAME_START:
+			snprintf(what, sizeof(what), "frame start");
+			break;
+		case TRACE_FRAME_END:
+			snprintf(what, sizeof(what), "frame end");
+			break;
+		case TRACE_SPI_FLUSH:
+			snprintf(what, sizeof(what), "spi        %u bytes", r->a);
+			break;
+		case TRACE_UART_BACKLOG:
+			snprintf(what, sizeof(what), "uart       %u bytes, %u waiting", r->b, r->a);
+			break;
+		case TRACE_INPUT:
+			if (r->b == 2 && isprint(r->a)) {
+				snprintf(what, sizeof(what), "input      key '%c'", r->a);
+			} else {
+				snprintf(what, sizeof(what), "input      %s %u",
+					r->b < 3 ? sources[r->b] : "?", r->a);
+			}
+			break;
+		case TRACE_FIRE:
+			snprintf(what, sizeof(what), "fire       x %u, projectile %u", r->a, r->b);
+			break;
+		case TRACE_ASTEROID_SPAWN:
+			print_position(pos, sizeof(pos), r->a);
+			snprintf(what, sizeof(what), "spawn      %s after %u retries", pos, r->b);
+			break;
+		case TRACE_ASTEROID_HIT:
+			print_position(pos, sizeof(pos), r->a);
+			snprintf(what, sizeof(what), "hit        %s by projectile %u", pos, r->b);
+			break;
+		case TRACE_BASE_HIT:
+			print_position(pos, sizeof(pos), r->a);
+			snprintf(what, sizeof(what), "base hit   %s, %u lives left", pos, r->b);
+			break;
+		case TRACE_LOST:
+			snprintf(what, sizeof(what), "LOST       %u records", r->a);
+			break;
+		default:
+			snprintf(what, sizeof(what), "type %u     %02x %02x", r->type, r->a, r->b);
+			break;
+	}
+	printf("%2s %10.3f  %s\n", marker, ms(r->tick - first_tick), what);
+}
+
+static void print_timeline(void) {
+	for (uint32_t i = 0; i < num_records; i++) {
+		if (i == 0 || records[i].section != records[i-1].section) {
+			printf("--- section %u ---\n", records[i].section);
+		}
+		print_record(i, records[0].tick, "");
+	}
+	printf("\n");
+}
+
+// Pair each FRAME_END with the FRAME_START before it. move_base() calls
+// draw_frame() twice for one new_frame(), so ends without a start of
+// their own are skipped.
+static void find_frames(void) {
+	int32_t start = -1;
+	for (uint32_t i = 0; i < num_records; i++) {
+		Record* r = &records[i];
+		if (i > 0 && r->section != records[i-1].section) {
+			start = -1;
+		}
+		if (r->type == TRACE_FRAME_START) {
+			start = i;
+		} else if (r->type == TRACE_FRAME_END && start >= 0) {
+			if (num_frames == frames_size) {
+				frames = grow(frames, &frames_size, sizeof(Frame));
+			}
+			frames[num_frames++] = (Frame){ start, i, r->tick - records[start].tick };
+			start = -1;
+		}
+	}
+}
+
+static int by_ticks(const void* a, const void* b) {
+	const Frame* fa = a;
+	const Frame* fb = b;
+	if (fa->ticks != fb->ticks) {
+		return fa->ticks < fb->ticks ? -1 : 1;
+	}
+	return fa->start < fb->start ? -1 : 1;
+}
+
+static void print_frame_stats(int worst, int context) {
+	uint64_t total = 0;
+	uint32_t lost = 0;
+	for (uint32_t i = 0; i < num_records; i++) {
+		if (records[i].type == TRACE_LOST) {
+			lost += records[i].a;
+		}
+	}
+	printf("%u records, %u sections, %u lost, %u unreadable\n", num_records,
+		num_records ? records[num_records-1].section + 1 : 0, lost, bad_records);
+	if (num_frames == 0) {
+		printf("no complete frames\n");
+		return;
+	}
+
+	for (uint32_t i = 0; i < num_frames; i++) {
+		total += frames[i].ticks;
+	}
+	qsort(frames, num_frames, sizeof(Frame), by_ticks);
+	printf("frame time (ms, %d us resolution): %u frames, min %.3f, "
+		"mean %.3f, p99 %.3f, max %.3f\n", US_PER_TICK, num_frames,
+		ms(frames[0].ticks), ms(total) / num_frames,
+		ms(frames[(num_frames*99 + 99) / 100 - 1].ticks),
+		ms(frames[num_frames-1].ticks));
+
+	for (int w = 0; w < worst && w < (int)num_frames; w++) {
+		Frame* f = &frames[num_frames-1-w];
+		uint32_t from = f->start > (uint32_t)context ? f->start - context : 0;
+		uint32_t to = f->end + context < num_records ? f->end + context : num_records-1;
+		printf("\nworst frame %d: %.3f ms\n", w+1, ms(f->ticks));
+		for (uint32_t i = from; i <= to; i++) {
+			if (records[i].section != records[f->start].section) {
+				continue;
+			}
+			print_record(i, records[0].tick, i >= f->start && i <= f->end ? ">" : "");
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	int hex = 0, stats_only = 0, worst = 5, context = 4;
+	const char* log = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--hex")) {
+			hex = 1;
+		} else if (!strcmp(argv[i], "--stats")) {
+			stats_only = 1;
+		} else if (!strcmp(argv[i], "--worst") && i+1 < argc) {
+			worst = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--context") && i+1 < argc) {
+			context = atoi(argv[++i]);
+		} else if (argv[i][0] == '-' || log) {
+			usage();
+		} else {
+			log = argv[i];
+		}
+	}
+
+	FILE* in = log ? fopen(log, "rb") : stdin;
+	if (!in) {
+		perror(log);
+		return 2;
+	}
+	size_t length;
+	uint8_t* data = read_log(in, hex, &length);
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	parse_log(data, length);
+	free(data);
+	if (!stats_only) {
+		print_timeline();
+	}
+	find_frames();
+	print_frame_stats(worst, context);
+	return num_records ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/*
+ * main.c
+ *
+ * Created: 20/10/2026 3:40:44 PM
+ *  Author: Kenton
+ *
+ * Command line front end to the terminal model. Reads a capture of the
+ * bytes sent to the terminal - hex bytes, one frame per line, '#'
+ * comments (as written by simbench --captures) - and prints the counts
+ * and the final screen. Exits with status 1 if any sequence wasn't
+ * understood.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "vtsim.h"
+
+static VtSim vt;
+
+static void usage(void) {
+	fprintf(stderr, "usage: vtsim [--size <columns>x<rows>] [--screen] "
+		"[--every-frame] [capture]\n");
+	exit(2);
+}
+
+int main(int argc, char** argv) {
+	const char* capture = NULL;
+	int columns = 120, rows = 40;
+	int screen = 0, every_frame = 0;
+	char line[16384];
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--size") == 0 && i+1 < argc) {
+			if (sscanf(argv[++i], "%dx%d", &columns, &rows) != 2) {
+				usage();
+			}
+		} else if (strcmp(argv[i], "--screen") == 0) {
+			screen = 1;
+		} else if (strcmp(argv[i], "--every-frame") == 0) {
+			every_frame = 1;
+		} else if (argv[i][0] == '-' || capture) {
+			usage();
+		} else {
+			capture = argv[i];
+		}
+	}
+	if (columns < 1 || rows < 1) {
+		usage();
+	}
+
+	FILE* in = capture ? fopen(capture, "r") : stdin;
+	if (!in) {
+		perror(capture);
+		return 2;
+	}
+	vtsim_init(&vt, columns, rows, stderr);
+	while (fgets(line, sizeof(line), in)) {
+		char* p = line;
+		if (line[0] == '#') {
+			continue;
+		}
+		while (*p) {
+			char* end;
+			unsigned long byte = strtoul(p, &end, 16);
+			if (end == p) {
+				if (!isspace((unsigned char)*p)) {
+					fprintf(stderr, "vtsim: bad byte '%c' in capture\n", *p);
+					return 2;
+				}
+				p++;
+				continue;
+			}
+			vtsim_byte(&vt, (uint8_t)byte);
+			p = end;
+		}
+		vtsim_end_frame(&vt);
+		if (every_frame) {
+			printf("frame %u\n", vt.frames);
+			vtsim_print_screen(&vt, stdout);
+		}
+	}
+	if (in != stdin) {
+		fclose(in);
+	}
+
+	if (screen && !every_frame) {
+		vtsim_print_screen(&vt, stdout);
+	}
+	vtsim_print_stats(&vt, stdout);
+	return vt.total.unsupported ? 1 : 0;
+}
@@ -0,0 +1,481 @@
+/*
+ * vtsim.c
+ *
+ * Created: 20/10/2026 3:02:31 PM
+ *  Author: Kenton
+ */
+
+#include <string.h>
+
+#include "vtsim.h"
+
+// Parser states
+#define S_GROUND	0
+#define S_ESC		1
+#define S_CSI		2
+#define S_STRING	3	// APC, OSC, DCS, PM or SOS string
+#define S_STRING_ESC	4	// ... after an ESC, which may start ST
+
+static const VtAttr default_attr = { VTSIM_DEFAULT_COLOUR, VTSIM_DEFAULT_COLOUR, 0 };
+
+static int same_attr(VtAttr a, VtAttr b) {
+	return a.fg == b.fg && a.bg == b.bg && a.flags == b.flags;
+}
+
+static void unsupported(VtSim* vt, const char* what, char final) {
+	vt->frame.unsupported++;
+	if (vt->log) {
+		fprintf(vt->log, "vtsim: frame %u: unsupported %s '%c'\n",
+			vt->frames, what, final);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+// Changing the screen. Everything goes through these so that changed
+// and moved are kept up to date.
+
+static void put_cell(VtSim* vt, int x, int y, char c, VtAttr attr) {
+	VtCell* cell = &vt->grid[y][x];
+	if (cell->c != c || !same_attr(cell->attr, attr)) {
+		cell->c = c;
+		cell->attr = attr;
+		vt->changed = 1;
+	}
+}
+
+static void blank_cell(VtSim* vt, int x, int y) {
+	// Erased cells keep the current background, as in xterm
+	VtAttr blank = default_attr;
+	blank.bg = vt->attr.bg;
+	put_cell(vt, x, y, ' ', blank);
+}
+
+static void set_cursor(VtSim* vt, int x, int y) {
+	if (x < 0) x = 0;
+	if (x >= vt->columns) x = vt->columns-1;
+	if (y < 0) y = 0;
+	if (y >= vt->rows) y = vt->rows-1;
+	if (x != vt->x || y != vt->y || vt->wrap_pending) {
+		vt->moved = 1;
+	}
+	vt->x = x;
+	vt->y = y;
+	vt->wrap_pending = 0;
+}
+
+static void set_attr(VtSim* vt, VtAttr attr) {
+	if (!same_attr(vt->attr, attr)) {
+		vt->attr = attr;
+		vt->moved = 1;
+	}
+}
+
+// Scroll the scroll region up (lines move towards the top) or down
+static void scroll(VtSim* vt, int up) {
+	static VtCell before[VTSIM_MAX_ROWS][VTSIM_MAX_COLUMNS];
+	int top = vt->top, bottom = vt->bottom;
+	size_t row = sizeof(vt->grid[0]);
+	int changed = vt->changed;
+
+	memcpy(before, vt->grid, sizeof(before));
+	if (up) {
+		memmove(vt->grid[top], vt->grid[top+1], row * (bottom-top));
+	} else {
+		memmove(vt->grid[top+1], vt->grid[top], row * (bottom-top));
+	}
+	for (int x = 0; x < vt->columns; x++) {
+		blank_cell(vt, x, up ? bottom : top);
+	}
+	// Scrolling blank lines changes nothing
+	vt->changed = changed
+		|| memcmp(before[top], vt->grid[top], row * (bottom-top+1)) != 0;
+}
+
+static void index_down(VtSim* vt) {
+	if (vt->y == vt->bottom) {
+		scroll(vt, 1);
+	} else {
+		set_cursor(vt, vt->x, vt->y+1);
+	}
+}
+
+static void reverse_index(VtSim* vt) {
+	if (vt->y == vt->top) {
+		scroll(vt, 0);
+	} else {
+		set_cursor(vt, vt->x, vt->y-1);
+	}
+}
+
+static void print_char(VtSim* vt, char c) {
+	if (vt->wrap_pending) {
+		set_cursor(vt, 0, vt->y);
+		index_down(vt);
+	}
+	put_cell(vt, vt->x, vt->y, c, vt->attr);
+	vt->moved = 1;
+	if (vt->x == vt->columns-1) {
+		vt->wrap_pending = 1;
+	} else {
+		vt->x++;
+	}
+}
+
+static void erase(VtSim* vt, int x1, int y1, int x2, int y2) {
+	// From (x1,y1) to (x2,y2) inclusive, in reading order
+	for (int y = y1; y <= y2; y++) {
+		int from = (y == y1) ? x1 : 0;
+		int to = (y == y2) ? x2 : vt->columns-1;
+		for (int x = from; x <= to; x++) {
+			blank_cell(vt, x, y);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+// Sequences
+
+static int param(VtSim* vt, int i, int fallback) {
+	return (i < vt->num_params && vt->params[i] > 0) ? vt->params[i] : fallback;
+}
+
+static void sgr(VtSim* vt) {
+	VtAttr attr = vt->attr;
+	int count = vt->num_params ? vt->num_params : 1;
+	for (int i = 0; i < count; i++) {
+		int p = i < vt->num_params ? vt->params[i] : 0;
+		if (p == 0) {
+			attr = default_attr;
+		} else if (p == 1) {
+			attr.flags |= VTSIM_BRIGHT;
+		} else if (p == 2) {
+			attr.flags |= VTSIM_DIM;
+		} else if (p == 4) {
+			attr.flags |= VTSIM_UNDERSCORE;
+		} else if (p == 5) {
+			attr.flags |= VTSIM_BLINK;
+		} else if (p == 7) {
+			attr.flags |= VTSIM_REVERSE;
+		} else if (p == 8) {
+			attr.flags |= VTSIM_HIDDEN;
+		} else if (p == 22) {
+			attr.flags &= ~(VTSIM_BRIGHT|VTSIM_DIM);
+		} else if (p == 24) {
+			attr.flags &= ~VTSIM_UNDERSCORE;
+		} else if (p == 25) {
+			attr.flags &= ~VTSIM_BLINK;
+		} else if (p == 27) {
+			attr.flags &= ~VTSIM_REVERSE;
+		} else if (p == 28) {
+			attr.flags &= ~VTSIM_HIDDEN;
+		} else if (p >= 30 && p <= 37) {
+			attr.fg = p - 30;
+		} else if (p == 39) {
+			attr.fg = VTSIM_DEFAULT_COLOUR;
+		} else if (p >= 40 && p <= 47) {
+			attr.bg = p - 40;
+		} else if (p == 49) {
+			attr.bg = VTSIM_DEFAULT_COLOUR;
+		} else {
+			unsupported(vt, "SGR parameter", 'm');
+		}
+	}
+	set_attr(vt, attr);
+}
+
+static void dispatch_csi(VtSim* vt, char final) {
+	if (vt->private_marker == '?') {
+		if ((final == 'h' || final == 'l') && param(vt, 0, 0) == 25) {
+			int visible = (final == 'h');
+			if (visible != vt->cursor_visible) {
+				vt->cursor_visible = visible;
+				vt->moved = 1;
+			}
+		} else {
+			unsupported(vt, "private sequence", final);
+		}
+		return;
+	}
+	switch (final) {
+		case 'H':
+		case 'f':
+			set_cursor(vt, param(vt, 1, 1) - 1, param(vt, 0, 1) - 1);
+			break;
+		case 'A':
+			set_cursor(vt, vt->x, vt->y - param(vt, 0, 1));
+			break;
+		case 'B':
+			set_cursor(vt, vt->x, vt->y + param(vt, 0, 1));
+			break;
+		case 'C':
+			set_cursor(vt, vt->x + param(vt, 0, 1), vt->y);
+			break;
+		case 'D':
+			set_cursor(vt, vt->x - param(vt, 0, 1), vt->y);
+			break;
+		case 'm':
+			sgr(vt);
+			break;
+		case 'J':
+			switch (param(vt, 0, 0)) {
+				case 0: erase(vt, vt->x, vt->y, vt->columns-1, vt->rows-1); break;
+				case 1: erase(vt, 0, 0, vt->x, vt->y); break;
+				case 2: erase(vt, 0, 0, vt->columns-1, vt->rows-1); break;
+				default: unsupported(vt, "erase", final); break;
+			}
+			break;
+		case 'K':
+			switch (param(vt, 0, 0)) {
+				case 0: erase(vt, vt->x, vt->y, vt->columns-1, vt->y); break;
+				case 1: erase(vt, 0, vt->y, vt->x, vt->y); break;
+				case 2: erase(vt, 0, vt->y, vt->columns-1, vt->y); break;
+				default: unsupported(vt, "erase", final); break;
+			}
+			break;
+		case 'r': {
+			int top = param(vt, 0, 1) - 1;
+			int bottom = param(vt, 1, vt->rows) - 1;
+			if (bottom >= vt->rows) {
+				bottom = vt->rows-1;
+			}
+			if (top < bottom) {
+				if (top != vt->top || bottom != vt->bottom) {
+					vt->top = top;
+					vt->bottom = bottom;
+					vt->moved = 1;
+				}
+				set_cursor(vt, 0, 0);
+			}
+			break;
+		}
+		default:
+			unsupported(vt, "CSI sequence", final);
+			break;
+	}
+}
+
+static void dispatch_esc(VtSim* vt, char final) {
+	switch (final) {
+		case 'D':
+			index_down(vt);
+			break;
+		case 'M':
+			reverse_index(vt);
+			break;
+		case 'E':
+			set_cursor(vt, 0, vt->y);
+			index_down(vt);
+			break;
+		default:
+			unsupported(vt, "escape", final);
+			break;
+	}
+}
+
+static void control(VtSim* vt, uint8_t c) {
+	switch (c) {
+		case '\b':
+			set_cursor(vt, vt->x-1, vt->y);
+			break;
+		case '\r':
+			set_cursor(vt, 0, vt->y);
+			break;
+		case '\n':
+			index_down(vt);
+			break;
+		case '\t':
+			set_cursor(vt, (vt->x/8 + 1) * 8, vt->y);
+			break;
+		default:
+			break;	// bell etc. - no effect
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+
+// Account for a finished character, control or sequence of len bytes
+static void finish(VtSim* vt, uint32_t len, int is_write) {
+	if (vt->changed) {
+		vt->pending = 0;	// everything leading up to it was needed
+	} else if (is_write) {
+		vt->frame.redundant += vt->pending + len;
+		vt->pending = 0;
+	} else if (vt->moved) {
+		vt->pending += len;
+	} else {
+		vt->frame.redundant += len;
+	}
+	vt->changed = 0;
+	vt->moved = 0;
+}
+
+void vtsim_init(VtSim* vt, int columns, int rows, FILE* log) {
+	memset(vt, 0, sizeof(*vt));
+	vt->columns = columns < VTSIM_MAX_COLUMNS ? columns : VTSIM_MAX_COLUMNS;
+	vt->rows = rows < VTSIM_MAX_ROWS ? rows : VTSIM_MAX_ROWS;
+	vt->attr = default_attr;
+	vt->top = 0;
+	vt->bottom = vt->rows-1;
+	vt->cursor_visible = 1;
+	vt->log = log;
+	for (int y = 0; y < vt->rows; y++) {
+		for (int x = 0; x < vt->columns; x++) {
+			vt->grid[y][x].c = ' ';
+			vt->grid[y][x].attr = default_attr;
+		}
+	}
+}
+
+void vtsim_byte(VtSim* vt, uint8_t byte) {
+	vt->frame.bytes++;
+
+	switch (vt->state) {
+		case S_GROUND:
+			if (byte == 27) {
+				vt->state = S_ESC;
+				vt->sequence_bytes = 1;
+			} else if (byte < 0x20 || byte == 0x7f) {
+				control(vt, byte);
+				finish(vt, 1, 0);
+			} else {
+				print_char(vt, byte < 0x80 ? (char)byte : '?');
+				finish(vt, 1, 1);
+			}
+			break;
+
+		case S_ESC:
+			vt->sequence_bytes++;
+			if (byte == '[') {
+				vt->state = S_CSI;
+				vt->private_marker = 0;
+				vt->num_params = 0;
+				memset(vt->params, 0, sizeof(vt->params));
+			} else if (byte == '_' || byte == ']' || byte == 'P'
+					|| byte == '^' || byte == 'X') {
+				// A string for the terminal to swallow (e.g. the event
+				// trace, in APC strings). It has no effect, and isn't
+				// counted as redundant either.
+				vt->state = S_STRING;
+				vt->frame.sequences++;
+				vt->frame.string_bytes += 2;
+			} else {
+				vt->state = S_GROUND;
+				vt->frame.sequences++;
+				dispatch_esc(vt, byte);
+				finish(vt, vt->sequence_bytes, 0);
+			}
+			break;
+
+		case S_CSI:
+			vt->sequence_bytes++;
+			if (byte >= '0' && byte <= '9') {
+				if (vt->num_params == 0) {
+					vt->num_params = 1;
+				}
+				int* p = &vt->params[vt->num_params-1];
+				if (*p < 10000) {
+					*p = *p * 10 + (byte - '0');
+				}
+			} else if (byte == ';') {
+				if (vt->num_params == 0) {
+					vt->num_params = 1;
+				}
+				if (vt->num_params < 8) {
+					vt->num_params++;
+				}
+			} else if (byte >= '<' && byte <= '?' && vt->sequence_bytes == 3) {
+				vt->private_marker = byte;
+			} else if (byte >= 0x40 && byte <= 0x7e) {
+				vt->state = S_GROUND;
+				vt->frame.sequences++;
+				dispatch_csi(vt, byte);
+				finish(vt, vt->sequence_bytes, 0);
+			} else if (byte == 27) {
+				// Broken off by a new sequence
+				unsupported(vt, "unterminated CSI before", '\x1b');
+				finish(vt, vt->sequence_bytes - 1, 0);
+				vt->state = S_ESC;
+				vt->sequence_bytes = 1;
+			} else if (byte < 0x20) {
+				// Controls are acted on in the middle of a sequence
+				control(vt, byte);
+			}
+			break;
+
+		case S_STRING:
+			vt->frame.string_bytes++;
+			if (byte == 27) {
+				vt->state = S_STRING_ESC;
+			} else if (byte == 7) {
+				vt->state = S_GROUND;	// BEL ends an OSC string too
+			}
+			break;
+
+		case S_STRING_ESC:
+			if (byte == '\\') {
+				vt->frame.string_bytes++;
+				vt->state = S_GROUND;
+			} else {
+				// Any other sequence cuts the string short
+				unsupported(vt, "unterminated string before", byte);
+				vt->frame.bytes--;
+				vt->state = S_ESC;
+				vt->sequence_bytes = 1;
+				vtsim_byte(vt, byte);
+			}
+			break;
+	}
+}
+
+static void fold(uint32_t* total, uint32_t* max, uint32_t value) {
+	*total += value;
+	if (value > *max) {
+		*max = value;
+	}
+}
+
+void vtsim_end_frame(VtSim* vt) {
+	VtStats* f = &vt->frame;
+	fold(&vt->total.bytes, &vt->max.bytes, f->bytes);
+	fold(&vt->total.sequences, &vt->max.sequences, f->sequences);
+	fold(&vt->total.redundant, &vt->max.redundant, f->redundant);
+	fold(&vt->total.unsupported, &vt->max.unsupported, f->unsupported);
+	fold(&vt->total.string_bytes, &vt->max.string_bytes, f->string_bytes);
+	memset(f, 0, sizeof(*f));
+	vt->frames++;
+}
+
+VtCell* vtsim_cell(VtSim* vt, int x, int y) {
+	if (x < 1 || y < 1 || x > vt->columns || y > vt->rows) {
+		return NULL;
+	}
+	return &vt->grid[y-1][x-1];
+}
+
+void vtsim_print_region(VtSim* vt, FILE* out, int x1, int y1, int x2, int y2) {
+	for (int y = y1; y <= y2; y++) {
+		int end = x2;
+		while (end >= x1 && vtsim_cell(vt, end, y) && vtsim_cell(vt, end, y)->c == ' ') {
+			end--;
+		}
+		for (int x = x1; x <= end; x++) {
+			VtCell* cell = vtsim_cell(vt, x, y);
+			fputc(cell ? cell->c : ' ', out);
+		}
+		fputc('\n', out);
+	}
+}
+
+void vtsim_print_screen(VtSim* vt, FILE* out) {
+	vtsim_print_region(vt, out, 1, 1, vt->columns, vt->rows);
+}
+
+void vtsim_print_stats(VtSim* vt, FILE* out) {
+	fprintf(out, "%-16s %10s %10s\n", "", "total", "frame max");
+	fprintf(out, "%-16s %10u\n", "frames", vt->frames);
+	fprintf(out, "%-16s %10u %10u\n", "bytes", vt->total.bytes, vt->max.bytes);
+	fprintf(out, "%-16s %10u %10u\n", "sequences", vt->total.sequences, vt->max.sequences);
+	fprintf(out, "%-16s %10u %10u\n", "redundant bytes", vt->total.redundant, vt->max.redundant);
+	fprintf(out, "%-16s %10u %10u\n", "unsupported", vt->total.unsupported, vt->max.unsupported);
+	fprintf(out, "%-16s %10u %10u\n", "string bytes", vt->total.string_bytes, vt->max.string_bytes);
+}
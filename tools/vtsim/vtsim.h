@@ -0,0 +1,116 @@
+/*
+ * vtsim.h
+ *
+ * Created: 20/10/2026 3:02:18 PM
+ *  Author: Kenton
+ *
+ * Headless model of the VT100 subset the firmware sends over USART0
+ * (terminalio.c, display.c): CUP, cursor up/down/left/right, SGR, ED,
+ * EL, DECSTBM, IND/RI, cursor show/hide, and backspace, carriage return
+ * and line feed. Bytes go in one at a time and a grid of characters and
+ * attributes comes out.
+ *
+ * It also measures the output. Every byte is counted, and bytes which
+ * change nothing are counted as redundant:
+ *  - a cursor move, attribute change or erase which leaves everything
+ *    as it was
+ *  - a character written over the same character with the same
+ *    attributes, along with the cursor moves and attribute changes that
+ *    led up to it
+ * Sequences the model doesn't understand are counted and ignored.
+ * Control strings (APC, OSC, DCS, PM, SOS - up to ST or, for OSC, BEL)
+ * are skipped the way a terminal skips them and counted separately; the
+ * event trace (trace.h) is sent in APC strings. As with ledsim, the
+ * caller decides where frames end.
+ */
+
+
+#ifndef VTSIM_H_
+#define VTSIM_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define VTSIM_MAX_COLUMNS 160
+#define VTSIM_MAX_ROWS 60
+
+// Cell attributes: colours are 0 to 7 (SGR 30-37/40-47) or
+// VTSIM_DEFAULT_COLOUR
+#define VTSIM_DEFAULT_COLOUR	9
+#define VTSIM_BRIGHT			(1<<0)
+#define VTSIM_DIM				(1<<1)
+#define VTSIM_UNDERSCORE		(1<<2)
+#define VTSIM_BLINK				(1<<3)
+#define VTSIM_REVERSE			(1<<4)
+#define VTSIM_HIDDEN			(1<<5)
+
+typedef struct {
+	uint8_t fg;
+	uint8_t bg;
+	uint8_t flags;
+} VtAttr;
+
+typedef struct {
+	char c;
+	VtAttr attr;
+} VtCell;
+
+typedef struct {
+	uint32_t bytes;
+	uint32_t sequences;		// escape sequences
+	uint32_t redundant;		// bytes which changed nothing
+	uint32_t unsupported;	// sequences the model ignored
+	uint32_t string_bytes;	// bytes of APC/OSC/DCS strings (ignored)
+} VtStats;
+
+typedef struct {
+	int columns, rows;
+	VtCell grid[VTSIM_MAX_ROWS][VTSIM_MAX_COLUMNS];
+
+	// Terminal state. The cursor is 0 based here (1 based on the wire).
+	int x, y;
+	int wrap_pending;	// at the right margin; the next character wraps
+	VtAttr attr;
+	int top, bottom;	// scroll region (0 based, inclusive)
+	int cursor_visible;
+
+	// Parser
+	int state;
+	char private_marker;
+	int params[8];
+	int num_params;
+	uint8_t sequence_bytes;
+	int changed;	// the current byte/sequence changed something visible
+	int moved;		// ... or changed the cursor, attributes or modes
+	uint32_t pending;	// bytes of cursor/attribute changes not yet used
+
+	uint32_t frames;
+	VtStats frame;
+	VtStats total;
+	VtStats max;
+
+	// Unsupported sequences are described here (if set)
+	FILE* log;
+} VtSim;
+
+void vtsim_init(VtSim* vt, int columns, int rows, FILE* log);
+
+// Feed one byte sent by the firmware
+void vtsim_byte(VtSim* vt, uint8_t byte);
+
+// Finish the current frame, folding its counts into the totals
+void vtsim_end_frame(VtSim* vt);
+
+// The cell at a terminal position - 1 based, as in move_cursor().
+// Returns NULL off the screen.
+VtCell* vtsim_cell(VtSim* vt, int x, int y);
+
+// Print the screen (trailing blanks trimmed), or just the given
+// rectangle of it (1 based, inclusive)
+void vtsim_print_screen(VtSim* vt, FILE* out);
+void vtsim_print_region(VtSim* vt, FILE* out, int x1, int y1, int x2, int y2);
+
+// Print the counts for the current frame, totals and per-frame maxima
+void vtsim_print_stats(VtSim* vt, FILE* out);
+
+#endif /* VTSIM_H_ */
@@ -0,0 +1,100 @@
+/*
+ * trace.c
+ *
+ * Created: 20/10/2026 6:05:44 PM
+ *  Author: Kenton
+ */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "trace.h"
+#include "telemetry.h"
+#include "emit.h"
+#include "sram.h"
+
+// Records are sent in APC strings of at most this many
+#define RECORDS_PER_STRING 8
+
+TraceRecord trace_ring[TRACE_SIZE];
+uint16_t trace_written;
+uint8_t trace_full;
+
+// Records sent by trace_stream() so far (compared with trace_written)
+static uint16_t trace_sent;
+static uint8_t streaming;
+
+SRAM_USAGE(trace, sizeof(trace_ring) + sizeof(trace_written)
+	+ sizeof(trace_full) + sizeof(trace_sent) + sizeof(streaming));
+
+// Number of the oldest record still in the ring, given the number
+// written. trace_written wraps after 65536 records, so whether the ring
+// holds TRACE_SIZE records comes from trace_full rather than from
+// comparing the count.
+static uint16_t oldest_record(uint16_t written) {
+	return trace_full ? written - TRACE_SIZE : 0;
+}
+
+static void emit_hex(uint8_t value) {
+	static const char digits[] PROGMEM = "0123456789abcdef";
+	emit_char(pgm_read_byte(&digits[value >> 4]));
+	emit_char(pgm_read_byte(&digits[value & 0x0f]));
+}
+
+// Send count records starting from record number first (a count of
+// records written, not a ring index), as one APC string. All fields are
+// sent big endian.
+static void emit_records(uint16_t first, uint8_t count) {
+	telemetry_begin();
+	emit_P(PSTR("\x1b_T"));
+	for (uint8_t i = 0; i < count; i++) {
+		TraceRecord* r = &trace_ring[(uint8_t)(first + i) & (TRACE_SIZE-1)];
+		emit_hex(r->tick >> 8);
+		emit_hex(r->tick & 0xff);
+		emit_hex(r->type);
+		emit_hex(r->a);
+		emit_hex(r->b);
+	}
+	emit_P(PSTR("\x1b\\"));
+	telemetry_end();
+}
+
+void trace_dump(void) {
+	// Take a copy of the count first - records written while we're
+	// sending (there shouldn't be any) would overwrite the oldest
+	uint16_t end = trace_written;
+	uint16_t start = oldest_record(end);
+	while (start != end) {
+		uint8_t count = end - start > RECORDS_PER_STRING
+			? RECORDS_PER_STRING : end - start;
+		emit_records(start, count);
+		start += count;
+	}
+}
+
+void toggle_trace_stream(void) {
+	streaming ^= 1;
+	// Start from what's in the ring now
+	trace_sent = oldest_record(trace_written);
+}
+
+void trace_stream(void) {
+	if (!streaming || telemetry_backlog() > TRACE_STREAM_BACKLOG) {
+		return;
+	}
+	uint16_t waiting = trace_written - trace_sent;
+	if (waiting == 0) {
+		return;
+	}
+	if (waiting > TRACE_SIZE) {
+		// Overwritten before we got to them. Note it in the trace (and
+		// skip the oldest record, which the note itself replaces).
+		uint16_t lost = waiting - TRACE_SIZE + 1;
+		trace_sent = trace_written - TRACE_SIZE + 1;
+		TRACE(TRACE_LOST, lost > 255 ? 255 : lost, 0);
+		waiting = TRACE_SIZE;
+	}
+	uint8_t count = waiting > RECORDS_PER_STRING ? RECORDS_PER_STRING : waiting;
+	emit_records(trace_sent, count);
+	trace_sent += count;
+}
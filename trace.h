@@ -0,0 +1,109 @@
+/*
+ * trace.h
+ *
+ * Created: 20/10/2026 6:05:37 PM
+ *  Author: Kenton
+ *
+ * Event trace for working out what happened around a rare slow frame.
+ * TRACE(type, a, b) writes a 5 byte record - a timestamp, the event type
+ * and two bytes of payload - into a small ring in RAM, overwriting the
+ * oldest record. That's a couple of dozen cycles, so tracing can stay
+ * on in normal builds (set TRACE_ENABLED to 0 to compile it out).
+ *
+ * Timestamps are the low 16 bits of the timer 2 overflow count (see
+ * cycles.h) - 256 microsecond ticks which wrap every ~16.8 seconds.
+ *
+ * The ring is sent over the serial port (the telemetry port if there is
+ * one - see telemetry.h) either all at once on request (trace_dump())
+ * or continuously, a few records at a time whenever the output buffer
+ * is nearly empty (trace_stream(), run as a task).
+ * Records are sent as hex inside APC strings (ESC _ T ... ESC \), which
+ * terminals ignore, so they don't disturb the display but do turn up
+ * in a log of the serial output. tools/trace/decode_trace.c turns
+ * such a log into a timeline and frame time statistics.
+ *
+ * Byte counts in the payloads stop at 255. TRACE() must only be used
+ * from the main loop, not interrupt handlers.
+ */
+
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "cycles.h"
+
+#define TRACE_ENABLED 1
+
+// Records in the ring - must be a power of 2
+#define TRACE_SIZE 32
+
+// How often trace_stream() should run (ms), and how full the serial
+// output buffer can be for it to still send records
+#define TRACE_STREAM_INTERVAL 10
+#define TRACE_STREAM_BACKLOG 32
+
+// Event types. The payload bytes are given as (a, b).
+#define TRACE_FRAME_START		1	// new_frame()
+#define TRACE_FRAME_END			2	// end of draw_frame()
+#define TRACE_SPI_FLUSH			3	// (SPI bytes sent in the frame, 0)
+#define TRACE_UART_BACKLOG		4	// (bytes waiting to send, UART bytes queued in the frame)
+#define TRACE_INPUT				5	// (button/joystick/key low byte, source - see below)
+#define TRACE_FIRE				6	// (x, projectile number)
+#define TRACE_ASTEROID_SPAWN	7	// (position, placement attempts)
+#define TRACE_ASTEROID_HIT		8	// (position, projectile number)
+#define TRACE_BASE_HIT			9	// (position, lives left)
+#define TRACE_LOST				10	// (records lost from the stream, 0)
+
+// Sources of TRACE_INPUT
+#define TRACE_INPUT_BUTTON		0
+#define TRACE_INPUT_JOYSTICK	1
+#define TRACE_INPUT_KEY			2
+
+typedef struct {
+	uint16_t tick;
+	uint8_t type;
+	uint8_t a;
+	uint8_t b;
+} TraceRecord;
+
+extern TraceRecord trace_ring[TRACE_SIZE];
+extern uint16_t trace_written;	// records written since reset (wraps)
+extern uint8_t trace_full;		// whether the ring has been filled
+
+#if TRACE_ENABLED
+static inline void trace_record(uint8_t type, uint8_t a, uint8_t b) {
+	// Interrupts are off so that the overflow count can't change half
+	// way through being read
+	uint8_t sreg = SREG;
+	cli();
+	TraceRecord* r = &trace_ring[(uint8_t)trace_written & (TRACE_SIZE-1)];
+	r->tick = cycle_overflows;
+	r->type = type;
+	r->a = a;
+	r->b = b;
+	if (++trace_written == TRACE_SIZE) {
+		trace_full = 1;
+	}
+	SREG = sreg;
+}
+
+#define TRACE(type, a, b) trace_record((type), (uint8_t)(a), (uint8_t)(b))
+#else
+#define TRACE(type, a, b)
+#endif
+
+// Send every record in the ring, oldest first.
+void trace_dump(void);
+
+// Turn continuous streaming on or off.
+void toggle_trace_stream(void);
+
+// Send records written since the last call, if streaming is on and the
+// serial output isn't busy. If the ring has been overwritten before the
+// records could be sent a TRACE_LOST record says how many were missed.
+void trace_stream(void);
+
+#endif /* TRACE_H_ */